@@ -51,7 +51,20 @@ int main()
         [&](Regex& regex) { return rgmatch.match_for(regex, pattern1, pattern1 + strlen(pattern1)); },
         [&](Regex& regex) { return rgmatch.search_for(regex, pattern2, pattern2 + strlen(pattern2)); });
 
-    // (5) wrong regex
+    // (5) use the lazy DFA engine instead of the NFA
+    regex_str = "[^a-zA-Z0-9]*([x-zep]|RE)+";
+    pattern1 = "$&^#xxyzyyeREREREepyyp";
+    pattern2 = "$&^#xxyzyyepREREREepyypARE";
+    try_match_search(
+        regex_str, pattern1, pattern2,
+        [&](Regex& regex) {
+            return regex_match(regex, pattern1, pattern1 + strlen(pattern1), Match_engine::LAZY_DFA);
+        },
+        [&](Regex& regex) {
+            return regex_search(regex, pattern2, pattern2 + strlen(pattern2), Match_engine::LAZY_DFA);
+        });
+
+    // (6) wrong regex
     regex_str = "(ab|(c+d|[e-h]+z)e";
     try_match_search(
         regex_str, pattern1, pattern2,
@@ -56,7 +56,12 @@ public:
     }
 
 private:
-    void fill_char() { stream->read(buff.begin() + buff.cursor(), 1); }
+    void fill_char()
+    {
+        stream->read(buff.begin() + buff.cursor(), 1);
+        if (stream->gcount() == 0)
+            buff.set_cur_elem(EOF);
+    }
 
     void fill_buff_aux()
     {
@@ -0,0 +1,38 @@
+#pragma once
+#ifndef VIEW_BUFFER_H_PCC_
+#define VIEW_BUFFER_H_PCC_
+
+#include <cstdio>
+
+#include "pcc_config.h"
+
+namespace pcc
+{
+/**
+ * @brief read the chars of a range in memory directly, it has the interface of Stream_buff that the lexers use
+ *
+ *
+ * Nothing is copied, next() returns the chars of [beg, end) one by one, then EOF,
+ * and there is never more to fill, like a Stream_buff whose stream is at its end.
+ */
+template <typename Char_t>
+class View_buff
+{
+public:
+    View_buff() : cur(nullptr), end(nullptr) {}
+
+    View_buff(const Char_t* beg, const Char_t* end) : cur(beg), end(end) {}
+
+    void fill_buff() {}
+
+    bool has_stream() { return false; }
+
+    Char_t next() { return cur != end ? *cur++ : Char_t(EOF); }
+
+private:
+    const Char_t* cur;
+    const Char_t* end;
+};
+}  // namespace pcc
+
+#endif  // VIEW_BUFFER_H_PCC_
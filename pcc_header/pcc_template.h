@@ -3,6 +3,7 @@
 #define PCC_TEMPLATE_H_PCC_
 
 #include <cstdint>
+#include <functional>
 
 #include "pcc_config.h"
 #ifdef HAS_BOOST
@@ -22,8 +23,8 @@ template <typename T, size_t SIZE>
 using Small_vector = Vector<T>;
 #endif
 
-template <typename Key, typename Value>
-using Hash_map = std::unordered_map<Key, Value>;
+template <typename Key, typename Value, typename Hash = std::hash<Key>>
+using Hash_map = std::unordered_map<Key, Value, Hash>;
 
 template <typename Key, typename Value>
 using Mul_hash_map = std::unordered_multimap<Key, Value>;
@@ -34,6 +35,20 @@ using Hash_set = std::unordered_set<Key>;
 template <typename Key>
 using Mul_hash_set = std::unordered_multiset<Key>;
 
+/**
+ * @brief hash a whole Vector, used to key hash containers by a set of status
+ */
+template <typename T>
+struct Vector_hash {
+    size_t operator()(const Vector<T>& vec) const
+    {
+        size_t seed = vec.size();
+        for (const T& t : vec)
+            seed ^= std::hash<T>()(t) + 0x9e3779b9 + (seed << 6) + (seed >> 2);
+        return seed;
+    }
+};
+
 template <bool value>
 struct Boolean {
     static constexpr bool val = value;
@@ -0,0 +1,97 @@
+#pragma once
+#ifndef SPARSE_SET_H_PCC_
+#define SPARSE_SET_H_PCC_
+
+#include <utility>
+
+#include "pcc_config.h"
+#include "pcc_template.h"
+
+namespace pcc
+{
+/**
+ * @brief the sparse set of Briggs and Torczon, a set of integers in [0, capacity)
+ *
+ *
+ * insert, contains and clear are all O(1), and the elements are iterated in the order they were inserted.
+ *
+ * dense[0 ... size) are the elements, and sparse[e] is the index of the element e in dense,
+ * so e is in the set if sparse[e] < size && dense[sparse[e]] == e.
+ * Stale values in sparse are never trusted, so clear only needs to reset size.
+ */
+class Sparse_set
+{
+public:
+    Sparse_set() = default;
+
+    Sparse_set(UInt cap) { reserve(cap); }
+
+    Sparse_set(const Sparse_set&) = default;
+
+    Sparse_set(Sparse_set&&) = default;
+
+    Sparse_set& operator=(const Sparse_set&) = default;
+
+    Sparse_set& operator=(Sparse_set&&) = default;
+
+    ~Sparse_set() = default;
+
+    /**
+     * @brief make the set able to hold the integers in [0, cap), only allocate when cap grows
+     */
+    void reserve(UInt cap)
+    {
+        if (cap <= dense.size())
+            return;
+        dense.resize(cap);
+        sparse.resize(cap);
+    }
+
+    UInt capacity() const { return dense.size(); }
+
+    /**
+     * @return true if e was not in the set
+     */
+    bool insert(UInt e)
+    {
+        assert(e < capacity());
+        if (contains(e))
+            return false;
+        dense[count] = e;
+        sparse[e] = count++;
+        return true;
+    }
+
+    bool contains(UInt e) const
+    {
+        UInt index = sparse[e];
+        return index < count && dense[index] == e;
+    }
+
+    void clear() { count = 0; }
+
+    bool empty() const { return count == 0; }
+
+    UInt size() const { return count; }
+
+    UInt operator[](UInt index) const { return dense[index]; }
+
+    const UInt* begin() const { return dense.data(); }
+
+    const UInt* end() const { return dense.data() + count; }
+
+    void swap(Sparse_set& other)
+    {
+        dense.swap(other.dense);
+        sparse.swap(other.sparse);
+        std::swap(count, other.count);
+    }
+
+private:
+    Vector<UInt> dense;
+    Vector<UInt> sparse;
+    UInt count = 0;
+};
+}  // namespace pcc
+
+#endif  // SPARSE_SET_H_PCC_
@@ -0,0 +1,123 @@
+#pragma once
+#ifndef THREAD_POOL_H_PCC_
+#define THREAD_POOL_H_PCC_
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+#include "pcc_config.h"
+#include "pcc_template.h"
+
+namespace pcc
+{
+/**
+ * @brief a fixed number of threads that run the tasks of a parallel for
+ *
+ *
+ * run(task_num, fn) calls fn(task, thread_index) for every task in [0, task_num),
+ * the tasks are taken one by one by the threads that are free, the caller is the thread 0 and works too,
+ * and run returns when all the tasks are done.
+ * thread_index is in [0, size()), so the caller can give every thread its own scratch memory.
+ * Only one run can be called at the same time.
+ */
+class Thread_pool
+{
+public:
+    /**
+     * @param thread_num the number of the threads with the caller, 0 for std::thread::hardware_concurrency()
+     */
+    Thread_pool(UInt thread_num = 0)
+    {
+        if (thread_num == 0)
+            thread_num = std::max(1u, std::thread::hardware_concurrency());
+        for (UInt i = 1; i != thread_num; ++i)
+            workers.emplace_back([this, i] { work(i); });
+    }
+
+    Thread_pool(const Thread_pool&) = delete;
+
+    Thread_pool& operator=(const Thread_pool&) = delete;
+
+    ~Thread_pool()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopped = true;
+        }
+        wake.notify_all();
+        for (auto& worker : workers)
+            worker.join();
+    }
+
+    /**
+     * @return the number of the threads with the caller
+     */
+    UInt size() const { return UInt(workers.size() + 1); }
+
+    template <typename Fn>
+    void run(size_t task_num, Fn fn)
+    {
+        if (task_num == 0)
+            return;
+        std::function<void(size_t, UInt)> job = [&fn](size_t task, UInt thread_index) { fn(task, thread_index); };
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            current = &job;
+            total = task_num;
+            next_task.store(0);
+            running = UInt(workers.size());
+            ++round;
+        }
+        wake.notify_all();
+        take_tasks(0);
+
+        std::unique_lock<std::mutex> lock(mutex);
+        done.wait(lock, [this] { return running == 0; });
+        current = nullptr;
+    }
+
+private:
+    void work(UInt thread_index)
+    {
+        size_t seen_round = 0;
+        while (true) {
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                wake.wait(lock, [&] { return stopped || round != seen_round; });
+                if (stopped)
+                    return;
+                seen_round = round;
+            }
+            take_tasks(thread_index);
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                --running;
+            }
+            done.notify_one();
+        }
+    }
+
+    void take_tasks(UInt thread_index)
+    {
+        for (size_t task; (task = next_task.fetch_add(1)) < total;)
+            (*current)(task, thread_index);
+    }
+
+    Vector<std::thread> workers;
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::condition_variable done;
+    std::function<void(size_t, UInt)>* current = nullptr;
+    std::atomic<size_t> next_task{ 0 };
+    size_t total = 0;
+    size_t round = 0;
+    UInt running = 0;
+    bool stopped = false;
+};
+}  // namespace pcc
+
+#endif  // THREAD_POOL_H_PCC_
@@ -0,0 +1,255 @@
+#pragma once
+#ifndef AHO_CORASICK_H_PCC_
+#define AHO_CORASICK_H_PCC_
+
+#include <cstddef>
+#include <string>
+
+#include "byte_classes.h"
+#include "fa_status.h"
+#include "pcc_config.h"
+#include "pcc_template.h"
+
+namespace pcc
+{
+using namespace fa_status;
+
+/**
+ * @brief an occurrence of a literal: [offset, offset + length) from the begin of the buffer, id is the literal
+ */
+struct Literal_match {
+    size_t offset;
+    size_t length;
+    UInt id;
+};
+
+/**
+ * @brief match many literals in one scan with an Aho-Corasick automaton
+ *
+ *
+ * The trie of the literals is turned into a DFA at build time: every failure link is followed in advance,
+ * so the scan takes exactly one table lookup per char.
+ * The goto table has one column per Byte_classes class, the chars that are not in any literal share one class.
+ *
+ * find returns the leftmost-longest occurrence (the lowest id if the same literal is added twice),
+ * for_each_occurrence reports all the occurrences, overlapped ones too.
+ *
+ * For example, the literals: he, she, hers
+ *              a buffer: "ushers"
+ *              find: { 1, 3, 1 }
+ *              all the occurrences: { 1, 3, 1 }, { 2, 2, 0 }, { 2, 4, 2 }
+ */
+class Aho_corasick
+{
+public:
+    Aho_corasick() { clear(); }
+
+    Aho_corasick(const Aho_corasick&) = default;
+
+    Aho_corasick(Aho_corasick&&) = default;
+
+    Aho_corasick& operator=(const Aho_corasick&) = default;
+
+    Aho_corasick& operator=(Aho_corasick&&) = default;
+
+    ~Aho_corasick() = default;
+
+    /**
+     * @brief add a literal with the next id (from 0), the empty literal is ignored but still takes an id
+     */
+    UInt add(const std::string& literal)
+    {
+        literals.push_back(literal);
+        built = false;
+        return UInt(literals.size() - 1);
+    }
+
+    /**
+     * @brief build the automaton, it must be called after the literals are added and before the search
+     */
+    void build()
+    {
+        build_classes();
+        build_trie();
+        build_links();
+        built = true;
+    }
+
+    void clear()
+    {
+        literals.clear();
+        byte_classes.clear();
+        class_num = 1;
+        table.assign(1, ROOT);
+        depth.assign(1, 0);
+        fail.assign(1, ROOT);
+        match_node.assign(1, NO_NODE);
+        id_offsets.assign(2, 0);
+        ids.clear();
+        built = false;
+    }
+
+    bool empty() const { return literals.empty(); }
+
+    /**
+     * @return the number of the literals
+     */
+    size_t size() const { return literals.size(); }
+
+    const std::string& literal(UInt id) const { return literals[id]; }
+
+    /**
+     * @return the leftmost-longest occurrence in [beg + from, end), the offset is end - beg if there is none
+     */
+    template <typename Iter>
+    Literal_match find(Iter beg, Iter end, size_t from) const
+    {
+        assert(built);
+        const size_t size = end - beg;
+        Literal_match best{ size, 0, NO_PATTERN };
+        UInt node = ROOT;
+        for (size_t i = from; i < size; ++i) {
+            node = table[node * class_num + byte_classes.class_of(beg[i])];
+            UInt found = match_node[node];
+            if (found != NO_NODE) {
+                size_t offset = i + 1 - depth[found];
+                if (best.id == NO_PATTERN || offset < best.offset || (offset == best.offset && depth[found] > best.length))
+                    best = { offset, depth[found], ids[id_offsets[found]] };
+            }
+            // no literal that goes on from here begins at or before the best one
+            if (best.id != NO_PATTERN && i + 1 - depth[node] > best.offset)
+                break;
+        }
+        return best;
+    }
+
+    /**
+     * @brief call callback(Literal_match) for all the occurrences in [beg, end), in the order of their ends,
+     *        the scan stops if callback returns false
+     */
+    template <typename Iter, typename Callback>
+    void for_each_occurrence(Iter beg, Iter end, Callback callback) const
+    {
+        assert(built);
+        const size_t size = end - beg;
+        UInt node = ROOT;
+        for (size_t i = 0; i != size; ++i) {
+            node = table[node * class_num + byte_classes.class_of(beg[i])];
+            for (UInt found = match_node[node]; found != NO_NODE; found = match_node[fail[found]]) {
+                for (UInt k = id_offsets[found]; k != id_offsets[found + 1]; ++k) {
+                    if (!callback(Literal_match{ i + 1 - depth[found], depth[found], ids[k] }))
+                        return;
+                }
+            }
+        }
+    }
+
+    size_t memory_usage() const
+    {
+        size_t usage = sizeof(*this) + (table.capacity() + depth.capacity() + fail.capacity() + match_node.capacity() +
+                                        id_offsets.capacity() + ids.capacity()) *
+                                           sizeof(UInt);
+        for (auto& literal : literals)
+            usage += sizeof(literal) + literal.capacity();
+        return usage;
+    }
+
+    static constexpr UInt NO_PATTERN = UInt(-1);
+
+private:
+    static constexpr UInt ROOT = 0;
+    static constexpr UInt NO_NODE = UInt(-1);
+
+    /**
+     * @brief every char of the literals has its own class, all the other chars are in one class
+     */
+    void build_classes()
+    {
+        Status_t keys[CHAR_AMOUNT] = {};
+        for (auto& literal : literals) {
+            for (Char c : literal)
+                keys[UChar(c)] = UChar(c) + 1;
+        }
+        byte_classes.clear();
+        byte_classes.refine(keys);
+        class_num = byte_classes.size();
+    }
+
+    void build_trie()
+    {
+        table.assign(class_num, NO_NODE);
+        depth.assign(1, 0);
+        Vector<Vector<UInt>> node_ids(1);
+        for (UInt id = 0; id != literals.size(); ++id) {
+            if (literals[id].empty())
+                continue;
+            UInt node = ROOT;
+            for (Char c : literals[id]) {
+                UInt& next = table[node * class_num + byte_classes.class_of(c)];
+                if (next == NO_NODE) {
+                    next = UInt(depth.size());
+                    depth.push_back(depth[node] + 1);
+                    node_ids.emplace_back();
+                    table.resize(table.size() + class_num, NO_NODE);
+                }
+                node = table[node * class_num + byte_classes.class_of(c)];
+            }
+            node_ids[node].push_back(id);
+        }
+
+        id_offsets.assign(1, 0);
+        ids.clear();
+        for (auto& node_id : node_ids) {
+            ids.insert(ids.end(), node_id.begin(), node_id.end());
+            id_offsets.push_back(UInt(ids.size()));
+        }
+    }
+
+    /**
+     * @brief fill the failure links in BFS order, and replace the missing gotos by the gotos of the failure node
+     */
+    void build_links()
+    {
+        const UInt node_num = UInt(depth.size());
+        fail.assign(node_num, ROOT);
+        match_node.assign(node_num, NO_NODE);
+        Vector<UInt> queue;
+        queue.reserve(node_num);
+        for (UInt k = 0; k != class_num; ++k) {
+            UInt& next = table[ROOT * class_num + k];
+            if (next == NO_NODE) {
+                next = ROOT;
+            } else {
+                fail[next] = ROOT;
+                queue.push_back(next);
+            }
+        }
+        for (size_t head = 0; head != queue.size(); ++head) {
+            UInt node = queue[head];
+            match_node[node] = id_offsets[node] != id_offsets[node + 1] ? node : match_node[fail[node]];
+            for (UInt k = 0; k != class_num; ++k) {
+                UInt& next = table[node * class_num + k];
+                if (next == NO_NODE) {
+                    next = table[fail[node] * class_num + k];
+                } else {
+                    fail[next] = table[fail[node] * class_num + k];
+                    queue.push_back(next);
+                }
+            }
+        }
+    }
+
+    Vector<std::string> literals;
+    Byte_classes byte_classes;
+    UInt class_num;
+    Vector<UInt> table;         // table[node * class_num + class] is the next node
+    Vector<UInt> depth;         // the length of the string of the node
+    Vector<UInt> fail;          // the node of the longest proper suffix in the trie
+    Vector<UInt> match_node;    // the node of the longest literal that is a suffix, NO_NODE if there is none
+    Vector<UInt> id_offsets;    // the ids of the literals that end at node are ids[id_offsets[node] ... id_offsets[node + 1])
+    Vector<UInt> ids;
+    bool built;
+};
+}  // namespace pcc
+
+#endif  // AHO_CORASICK_H_PCC_
@@ -0,0 +1,429 @@
+#pragma once
+#ifndef BIT_PARALLEL_NFA_H_PCC_
+#define BIT_PARALLEL_NFA_H_PCC_
+
+#include <algorithm>
+#include <cstdint>
+#include <utility>
+
+#include "fa_status.h"
+#include "nfa_program.h"
+#include "pcc_config.h"
+#include "pcc_template.h"
+
+namespace pcc
+{
+using namespace fa_status;
+
+/**
+ * @brief the Glushkov (position) automaton of a small NFA_program, run with bit operations
+ *
+ *
+ * A position is a char trans of the program: a status with the chars that it trans to one target with.
+ * A match is in a set of positions, the positions that may take the next char, and it is one bit per position,
+ * so when there are no more than 64 positions the whole set is one uint64_t (128 and 256 positions take 2 and 4).
+ * A step with the char c is:
+ *
+ *   taken = active & char_masks[c]            the positions that take c
+ *   accept if taken & accept_mask             the target of a taken position accepts
+ *   active = follow(taken)                    the positions of the closures of their targets
+ *
+ * The positions are numbered so that a position is followed by the next one as often as possible
+ * (the chars of a sequence are numbered in order), then most of follow is one shift: (taken & shift_mask) << 1.
+ * The other followers are looked up by the chunks of taken that have such positions (Navarro and Raffinot):
+ * exception_tables[chunk][bits of the chunk] = the other followers of the positions in the chunk.
+ * The chunks are 8 bits for one word and 4 bits for more words, so a table is at most 32 KB.
+ *
+ * The sets of 2 and 4 words are not run with SSE2 / AVX2 instructions: take, accepts and follow are plain loops
+ * over the words of the set, the number of words is a template argument (WORDS), so the loops are unrolled.
+ * A 256 bit register would not help much, follow carries the shift from one word to the next.
+ *
+ * It is only built for the programs without counted repeats that have no more than MAX_POSITIONS positions.
+ *
+ * For example, a regex: a(b|c)*d
+ *              its positions: 0 : a, 1 : [bc] (b and c trans to the same status), 2 : d
+ *              shift_mask: 0, 1 (0 -> 1, 1 -> 2), the exception table: 0 -> 2, 1 -> 1
+ */
+template <typename Char_t>
+class Bit_parallel_nfa
+{
+public:
+    Bit_parallel_nfa() = default;
+
+    Bit_parallel_nfa(const Bit_parallel_nfa&) = default;
+
+    Bit_parallel_nfa(Bit_parallel_nfa&&) = default;
+
+    Bit_parallel_nfa& operator=(const Bit_parallel_nfa&) = default;
+
+    Bit_parallel_nfa& operator=(Bit_parallel_nfa&&) = default;
+
+    ~Bit_parallel_nfa() = default;
+
+    /**
+     * @brief build the automaton from the positions of the program
+     *
+     * @return false if the program has counted repeats or more than MAX_POSITIONS positions, it is left empty
+     */
+    bool build(const NFA_program<Char_t>& program)
+    {
+        clear();
+        if (program.empty() || program.has_counters())
+            return false;
+
+        Vector<Position> positions;
+        Vector<UInt> position_offsets;
+        if (!collect_positions(program, positions, position_offsets))
+            return false;
+        const UInt size = positions.size();
+        words = size <= 64 ? 1 : size <= 128 ? 2 : 4;
+        chunk_bits = words == 1 ? 8 : 4;
+
+        // follows[p] = the positions of the closure of the target of p, numbered in the order they are found
+        Vector<Vector<UInt>> follows(size);
+        for (UInt p = 0; p != size; ++p) {
+            const Status_t target = positions[p].target;
+            for (auto iter = program.closure_begin(target); iter != program.closure_end(target); ++iter)
+                for (UInt q = position_offsets[*iter]; q != position_offsets[*iter + 1]; ++q)
+                    follows[p].push_back(q);
+        }
+        Vector<UInt> starts;
+        for (auto iter = program.closure_begin(program.start_status());
+             iter != program.closure_end(program.start_status()); ++iter) {
+            for (UInt q = position_offsets[*iter]; q != position_offsets[*iter + 1]; ++q)
+                starts.push_back(q);
+            start_accept = start_accept || program.is_accept(*iter);
+        }
+        Vector<UInt> number = number_positions(follows, starts);
+
+        char_masks.assign(CHAR_AMOUNT * words, 0);
+        accept_mask.assign(words, 0);
+        start_mask.assign(words, 0);
+        shift_mask.assign(words, 0);
+        Vector<Vector<UInt>> exceptions(size);
+        for (UInt p = 0; p != size; ++p) {
+            const UInt bit = number[p];
+            for (UInt c = 0; c != CHAR_AMOUNT; ++c)
+                if (positions[p].chars[c >> 6] >> (c & 63) & 1)
+                    set_bit(&char_masks[c * words], bit);
+            const Status_t target = positions[p].target;
+            for (auto iter = program.closure_begin(target); iter != program.closure_end(target); ++iter)
+                if (program.is_accept(*iter))
+                    set_bit(accept_mask.data(), bit);
+            for (UInt q : follows[p]) {
+                if (number[q] == bit + 1)
+                    set_bit(shift_mask.data(), bit);
+                else
+                    exceptions[bit].push_back(number[q]);
+            }
+        }
+        for (UInt q : starts)
+            set_bit(start_mask.data(), number[q]);
+        build_exception_tables(size, exceptions);
+        built = true;
+        return true;
+    }
+
+    void clear()
+    {
+        char_masks.clear();
+        accept_mask.clear();
+        start_mask.clear();
+        shift_mask.clear();
+        exception_chunks.clear();
+        exception_tables.clear();
+        words = 1;
+        chunk_bits = 8;
+        start_accept = false;
+        built = false;
+    }
+
+    bool empty() const { return !built; }
+
+    /**
+     * @return the number of uint64_t of a set of positions, 1, 2 or 4
+     */
+    UInt word_num() const { return words; }
+
+    /**
+     * @brief run [beg, end) from the begin, the same as the NFA engine of Basic_regex_match::match_for
+     *
+     * @return (where the match dies, or end), true if the match accepts at end
+     */
+    template <typename Iter>
+    std::pair<Iter, bool> match(Iter beg, Iter end) const
+    {
+        switch (words) {
+            case 1:
+                return match_words<1>(beg, end);
+            case 2:
+                return match_words<2>(beg, end);
+            default:
+                return match_words<4>(beg, end);
+        }
+    }
+
+    /**
+     * @brief run [beg, end) from the begin until the match dies, the same as Basic_regex_match::search_for
+     *
+     * @return (the end of the longest accepted prefix, or beg if none, where the match dies or end)
+     */
+    template <typename Iter>
+    std::pair<Iter, Iter> search(Iter beg, Iter end) const
+    {
+        switch (words) {
+            case 1:
+                return search_words<1>(beg, end);
+            case 2:
+                return search_words<2>(beg, end);
+            default:
+                return search_words<4>(beg, end);
+        }
+    }
+
+    /**
+     * @return the bytes of memory that the automaton uses
+     */
+    size_t memory_usage() const
+    {
+        return sizeof(*this) +
+               (char_masks.capacity() + accept_mask.capacity() + start_mask.capacity() + shift_mask.capacity() +
+                exception_tables.capacity()) *
+                   sizeof(uint64_t) +
+               exception_chunks.capacity() * sizeof(UInt);
+    }
+
+    static constexpr UInt MAX_POSITIONS = 256;
+
+private:
+    static constexpr UInt NO_POSITION = UInt(-1);
+
+    struct Position {
+        Status_t target;
+        uint64_t chars[CHAR_AMOUNT / 64];
+    };
+
+    /**
+     * @brief the positions of the status reachable from the start status, the positions of the status s are
+     *        positions[position_offsets[s] ... position_offsets[s + 1])
+     */
+    static bool collect_positions(const NFA_program<Char_t>& program, Vector<Position>& positions,
+                                  Vector<UInt>& position_offsets)
+    {
+        const Status_t size = program.size();
+        Vector<bool> reached(size, false);
+        Vector<Status_t> important;
+        auto reach = [&](Status_t s) {
+            for (auto iter = program.closure_begin(s); iter != program.closure_end(s); ++iter) {
+                if (!reached[*iter]) {
+                    reached[*iter] = true;
+                    important.push_back(*iter);
+                }
+            }
+        };
+        reach(program.start_status());
+        UInt position_num = 0;
+        for (size_t i = 0; i != important.size(); ++i) {
+            Vector<Status_t> targets;
+            for (auto range = program.ranges_begin(important[i]); range != program.ranges_end(important[i]);
+                 range += 2) {
+                const Status_t target = NFA_program<Char_t>::range_target(range);
+                if (is_dead_end(program, target))
+                    continue;
+                if (std::find(targets.begin(), targets.end(), target) == targets.end())
+                    targets.push_back(target);
+                reach(target);
+            }
+            position_num += targets.size();
+            if (position_num > MAX_POSITIONS)
+                return false;
+        }
+
+        // the status are walked in order, so that the positions of a status are contiguous
+        position_offsets.assign(size + 1, 0);
+        for (Status_t s = 0; s != size; ++s) {
+            position_offsets[s] = positions.size();
+            if (!reached[s])
+                continue;
+            const size_t first = positions.size();
+            for (auto range = program.ranges_begin(s); range != program.ranges_end(s); range += 2) {
+                const Status_t target = NFA_program<Char_t>::range_target(range);
+                if (is_dead_end(program, target))
+                    continue;
+                size_t p = first;
+                while (p != positions.size() && positions[p].target != target)
+                    ++p;
+                if (p == positions.size())
+                    positions.push_back(Position{ target, { 0, 0, 0, 0 } });
+                for (UInt c = NFA_program<Char_t>::range_lo(range); c <= NFA_program<Char_t>::range_hi(range); ++c)
+                    positions[p].chars[c >> 6] |= uint64_t(1) << (c & 63);
+            }
+        }
+        position_offsets[size] = positions.size();
+        return true;
+    }
+
+    /**
+     * @brief a char trans to a status with an empty closure kills the match at that char, so it is no position
+     */
+    static bool is_dead_end(const NFA_program<Char_t>& program, Status_t target)
+    {
+        return program.closure_begin(target) == program.closure_end(target);
+    }
+
+    /**
+     * @brief number the positions from the start positions, a position is followed by the next number
+     *        if one of its followers is not numbered yet, so a sequence of chars is numbered in order
+     */
+    static Vector<UInt> number_positions(const Vector<Vector<UInt>>& follows, const Vector<UInt>& starts)
+    {
+        Vector<UInt> number(follows.size(), NO_POSITION);
+        Vector<UInt> pending(starts);
+        UInt next_number = 0;
+        for (size_t i = 0; i != pending.size(); ++i) {
+            for (UInt p = pending[i]; p != NO_POSITION && number[p] == NO_POSITION;) {
+                number[p] = next_number++;
+                UInt chain = NO_POSITION;
+                for (UInt q : follows[p]) {
+                    if (number[q] != NO_POSITION)
+                        continue;
+                    if (chain == NO_POSITION)
+                        chain = q;
+                    else
+                        pending.push_back(q);
+                }
+                p = chain;
+            }
+        }
+        return number;
+    }
+
+    /**
+     * @brief exception_tables has 1 << chunk_bits rows for every chunk that has a position with other followers
+     */
+    void build_exception_tables(UInt size, const Vector<Vector<UInt>>& exceptions)
+    {
+        const UInt rows = 1 << chunk_bits;
+        for (UInt chunk = 0; chunk * chunk_bits < size; ++chunk) {
+            const UInt first = chunk * chunk_bits, last = std::min(size, first + chunk_bits);
+            bool has_exception = false;
+            for (UInt p = first; p != last; ++p)
+                has_exception = has_exception || !exceptions[p].empty();
+            if (!has_exception)
+                continue;
+
+            exception_chunks.push_back(chunk);
+            const size_t table = exception_tables.size();
+            exception_tables.resize(table + rows * words, 0);
+            // the row of bits is the row of bits without its lowest bit, with the followers of the lowest bit
+            for (UInt bits = 1; bits != rows; ++bits) {
+                uint64_t* row = &exception_tables[table + bits * words];
+                const uint64_t* rest = &exception_tables[table + (bits & (bits - 1)) * words];
+                std::copy(rest, rest + words, row);
+                const UInt p = first + __builtin_ctz(bits);
+                if (p < last)
+                    for (UInt q : exceptions[p])
+                        set_bit(row, q);
+            }
+        }
+    }
+
+    static void set_bit(uint64_t* set, UInt bit) { set[bit >> 6] |= uint64_t(1) << (bit & 63); }
+
+    /**
+     * @brief taken = active & char_masks[c]
+     *
+     * @return false if no position takes c
+     */
+    template <UInt WORDS>
+    bool take(const uint64_t* active, Char_t c, uint64_t* taken) const
+    {
+        const uint64_t* mask = &char_masks[UChar(c) * WORDS];
+        uint64_t any = 0;
+        for (UInt i = 0; i != WORDS; ++i) {
+            taken[i] = active[i] & mask[i];
+            any |= taken[i];
+        }
+        return any != 0;
+    }
+
+    template <UInt WORDS>
+    bool accepts(const uint64_t* taken) const
+    {
+        uint64_t any = 0;
+        for (UInt i = 0; i != WORDS; ++i)
+            any |= taken[i] & accept_mask[i];
+        return any != 0;
+    }
+
+    /**
+     * @brief active = the followers of the taken positions, by the shift and the exception tables
+     */
+    template <UInt WORDS>
+    void follow(const uint64_t* taken, uint64_t* active) const
+    {
+        constexpr UInt CHUNK_BITS = WORDS == 1 ? 8 : 4;
+        constexpr UInt ROWS = 1 << CHUNK_BITS;
+        uint64_t carry = 0;
+        for (UInt i = 0; i != WORDS; ++i) {
+            const uint64_t shifted = taken[i] & shift_mask[i];
+            active[i] = shifted << 1 | carry;
+            carry = shifted >> 63;
+        }
+        for (UInt index = 0; index != exception_chunks.size(); ++index) {
+            const UInt bit = exception_chunks[index] * CHUNK_BITS;
+            const UInt bits = UInt(taken[bit >> 6] >> (bit & 63)) & (ROWS - 1);
+            if (bits == 0)
+                continue;
+            const uint64_t* row = &exception_tables[(size_t(index) * ROWS + bits) * WORDS];
+            for (UInt i = 0; i != WORDS; ++i)
+                active[i] |= row[i];
+        }
+    }
+
+    template <UInt WORDS, typename Iter>
+    std::pair<Iter, bool> match_words(Iter beg, Iter end) const
+    {
+        uint64_t active[WORDS], taken[WORDS];
+        std::copy(start_mask.begin(), start_mask.end(), active);
+        bool accepted = start_accept;
+        for (Iter cursor = beg; cursor != end; ++cursor) {
+            if (!take<WORDS>(active, *cursor, taken))
+                return { cursor, false };
+            accepted = accepts<WORDS>(taken);
+            follow<WORDS>(taken, active);
+        }
+        return { end, accepted };
+    }
+
+    template <UInt WORDS, typename Iter>
+    std::pair<Iter, Iter> search_words(Iter beg, Iter end) const
+    {
+        uint64_t active[WORDS], taken[WORDS];
+        std::copy(start_mask.begin(), start_mask.end(), active);
+        Iter cursor = beg;
+        Iter last_accept_pos = beg;
+        for (; cursor != end; ++cursor) {
+            if (!take<WORDS>(active, *cursor, taken))
+                break;
+            if (accepts<WORDS>(taken))
+                last_accept_pos = cursor + 1;
+            follow<WORDS>(taken, active);
+        }
+        return { last_accept_pos, cursor };
+    }
+
+    Vector<uint64_t> char_masks;          // char_masks[c * words ...] = the positions that take the char c
+    Vector<uint64_t> accept_mask;         // the positions whose targets accept
+    Vector<uint64_t> start_mask;          // the positions of the closure of the start status
+    Vector<uint64_t> shift_mask;          // the positions followed by the next position
+    Vector<UInt> exception_chunks;
+    Vector<uint64_t> exception_tables;    // (1 << chunk_bits) * words for every chunk in exception_chunks
+    UInt words = 1;
+    UInt chunk_bits = 8;
+    bool start_accept = false;
+    bool built = false;
+};
+}  // namespace pcc
+
+#endif  // BIT_PARALLEL_NFA_H_PCC_
@@ -0,0 +1,90 @@
+#pragma once
+#ifndef BYTE_CLASSES_H_PCC_
+#define BYTE_CLASSES_H_PCC_
+
+#include <algorithm>
+#include <cstring>
+
+#include "fa_status.h"
+#include "pcc_config.h"
+#include "pcc_template.h"
+
+namespace pcc
+{
+using namespace fa_status;
+
+/**
+ * @brief a partition of all the chars into equivalence classes
+ *
+ *
+ * Two chars are in the same class if no transformation of the regex can tell them apart,
+ * so the transformation tables can have one column per class instead of one per char.
+ *
+ * For example, a regex: [a-z]+0
+ *              the classes: [a-z], [0], and all the other chars
+ */
+class Byte_classes
+{
+public:
+    Byte_classes() { clear(); }
+
+    /**
+     * @brief put all the chars into one class
+     */
+    void clear()
+    {
+        memset(classes, 0, sizeof(classes));
+        memset(represents, 0, sizeof(represents));
+        class_num = 1;
+    }
+
+    /**
+     * @brief split the classes so that chars with different keys are in different classes
+     *
+     * @param keys keys[c] is the key of the char c, for example the status that a NFA status trans to with c
+     */
+    void refine(const Status_t keys[CHAR_AMOUNT])
+    {
+        static constexpr UInt NO_CLASS = UInt(-1);
+        UInt first_new[CHAR_AMOUNT];   // the first new class split from an old class
+        UInt next_new[CHAR_AMOUNT];    // the next new class split from the same old class
+        Status_t class_keys[CHAR_AMOUNT];
+        UInt new_num = 0;
+        std::fill(first_new, first_new + class_num, NO_CLASS);
+
+        for (UInt c = 0; c != CHAR_AMOUNT; ++c) {
+            UInt* link = &first_new[classes[c]];
+            while (*link != NO_CLASS && class_keys[*link] != keys[c])
+                link = &next_new[*link];
+            if (*link == NO_CLASS) {
+                *link = new_num;
+                next_new[new_num] = NO_CLASS;
+                class_keys[new_num] = keys[c];
+                represents[new_num] = UChar(c);
+                ++new_num;
+            }
+            classes[c] = UChar(*link);
+        }
+        class_num = new_num;
+    }
+
+    UInt class_of(Char c) const { return classes[UChar(c)]; }
+
+    /**
+     * @return a char that belongs to the class
+     */
+    Char represent(UInt class_index) const { return Char(represents[class_index]); }
+
+    /**
+     * @return the number of classes
+     */
+    UInt size() const { return class_num; }
+
+private:
+    UChar classes[CHAR_AMOUNT];
+    UChar represents[CHAR_AMOUNT];
+    UInt class_num;
+};
+}  // namespace pcc
+
+#endif  // BYTE_CLASSES_H_PCC_
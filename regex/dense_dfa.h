@@ -0,0 +1,236 @@
+#pragma once
+#ifndef DENSE_DFA_H_PCC_
+#define DENSE_DFA_H_PCC_
+
+#include "byte_classes.h"
+#include "fa_status.h"
+#include "lazy_dfa.h"
+#include "pcc_config.h"
+#include "pcc_template.h"
+
+namespace pcc
+{
+using namespace fa_status;
+
+/**
+ * @brief the complete, minimized DFA of a NFA_program, built ahead of time
+ *
+ *
+ * The transformation table has one column per Byte_classes class of the regex,
+ * and the DFA status are numbered by the offset of their row in the table,
+ * so a step is only one table lookup after the class lookup: next = trans[status + class_of(c)]
+ *
+ * The DFA status 0 is always the dead status.
+ */
+template <typename Char_t>
+class Dense_dfa
+{
+public:
+    Dense_dfa() = default;
+
+    Dense_dfa(const Dense_dfa&) = default;
+
+    Dense_dfa(Dense_dfa&&) = default;
+
+    Dense_dfa& operator=(const Dense_dfa&) = default;
+
+    Dense_dfa& operator=(Dense_dfa&&) = default;
+
+    ~Dense_dfa() = default;
+
+    /**
+     * @brief subset construct the DFA from the NFA of the regex, then minimize it
+     *
+     * @return false if the DFA needs more than state_limit status, the DFA is left empty
+     */
+    bool build(const NFA_program<Char_t>& program, const Byte_classes& classes, UInt state_limit)
+    {
+        clear();
+        Vector<Status_t> subset_trans;
+        Vector<bool> subset_accept;
+        byte_classes = classes;
+        if (!subset_construct(program, state_limit, subset_trans, subset_accept))
+            return false;
+        minimize(subset_trans, subset_accept);
+        return true;
+    }
+
+    void clear()
+    {
+        trans.clear();
+        accept.clear();
+        start = DEAD_STATUS;
+    }
+
+    bool empty() const { return trans.empty(); }
+
+    Status_t start_status() const { return start; }
+
+    Status_t next_status(Status_t status, Char_t c) const { return trans[status + byte_classes.class_of(c)]; }
+
+    bool is_accept(Status_t status) const { return accept[status / byte_classes.size()]; }
+
+    static bool is_dead(Status_t status) { return status == DEAD_STATUS; }
+
+    /**
+     * @return the number of DFA status
+     */
+    size_t size() const { return accept.size(); }
+
+    /**
+     * @brief the DFA status are numbered by their row offsets, these map them to [0, size()) and back
+     */
+    size_t index_of(Status_t status) const { return status / byte_classes.size(); }
+
+    Status_t status_of(size_t index) const { return Status_t(index * byte_classes.size()); }
+
+    /**
+     * @return the bytes of memory that the DFA uses
+     */
+    size_t memory_usage() const { return sizeof(*this) + trans.capacity() * sizeof(Status_t) + accept.capacity() / 8; }
+
+    static constexpr UInt DEFAULT_STATE_LIMIT = 1 << 12;
+    static constexpr Status_t DEAD_STATUS = 0;
+
+private:
+    /**
+     * @brief explore every DFA status reachable from the start status with a Lazy_dfa that is never flushed
+     */
+    bool subset_construct(const NFA_program<Char_t>& program, UInt state_limit, Vector<Status_t>& subset_trans,
+                          Vector<bool>& subset_accept)
+    {
+        Lazy_dfa<Char_t> lazy(state_limit + 1);
+        lazy.reset_classes(byte_classes);
+        Status_t lazy_start = lazy.start_status(program);
+        if (lazy.flush_times() != 0)
+            return false;
+
+        for (Status_t status = 0; status != lazy.size(); ++status) {
+            for (UInt c = 0; c != byte_classes.size(); ++c) {
+                Status_t target = lazy.next_status(program, status, byte_classes.represent(c));
+                if (lazy.flush_times() != 0)
+                    return false;
+                subset_trans.push_back(target);
+            }
+            subset_accept.push_back(lazy.is_accept(status));
+        }
+        subset_start = lazy_start;
+        return true;
+    }
+
+    /**
+     * @brief Hopcroft's partition refinement
+     *
+     *
+     * The dead status is kept in a block of its own, so the minimized DFA fails at the same char as the NFA.
+     * When a block b is split, the new block is always the smaller half: if b is waiting in the worklist,
+     * both halves must split the others and the new block is pushed too, otherwise splitting by the smaller half
+     * is enough, the larger one is b and is not pushed again. So every status is in a splitter O(log(size)) times.
+     */
+    void minimize(const Vector<Status_t>& subset_trans, const Vector<bool>& subset_accept)
+    {
+        const Status_t size = subset_accept.size();
+        const UInt class_num = byte_classes.size();
+
+        // inverse[c][inverse_beg[c][t] ... inverse_beg[c][t + 1]) are the status that trans to t with class c
+        Vector<Vector<Status_t>> inverse(class_num), inverse_beg(class_num);
+        for (UInt c = 0; c != class_num; ++c) {
+            inverse_beg[c].assign(size + 1, 0);
+            for (Status_t s = 0; s != size; ++s)
+                ++inverse_beg[c][subset_trans[s * class_num + c] + 1];
+            for (Status_t t = 0; t != size; ++t)
+                inverse_beg[c][t + 1] += inverse_beg[c][t];
+            inverse[c].resize(size);
+            Vector<Status_t> fill(inverse_beg[c].begin(), inverse_beg[c].end() - 1);
+            for (Status_t s = 0; s != size; ++s)
+                inverse[c][fill[subset_trans[s * class_num + c]]++] = s;
+        }
+
+        Vector<Vector<Status_t>> blocks;
+        Vector<Status_t> block_of(size);
+        Vector<Status_t> accept_block, common_block;
+        for (Status_t s = 1; s != size; ++s)
+            (subset_accept[s] ? accept_block : common_block).push_back(s);
+        blocks.push_back({ DEAD_STATUS });
+        if (!accept_block.empty())
+            blocks.push_back(std::move(accept_block));
+        if (!common_block.empty())
+            blocks.push_back(std::move(common_block));
+        for (Status_t b = 0; b != blocks.size(); ++b)
+            for (Status_t s : blocks[b])
+                block_of[s] = b;
+
+        // the first blocks except the largest one, splitting by it is the same as splitting by the others
+        Vector<Status_t> worklist;
+        Status_t largest = 0;
+        for (Status_t b = 1; b != blocks.size(); ++b)
+            if (blocks[b].size() > blocks[largest].size())
+                largest = b;
+        for (Status_t b = 0; b != blocks.size(); ++b)
+            if (b != largest)
+                worklist.push_back(b);
+
+        Vector<Status_t> marked_count(size, 0);
+        Vector<bool> marked(size, false);
+        Vector<Status_t> touched_blocks;
+        Vector<Status_t> splitter;
+        while (!worklist.empty()) {
+            Status_t splitter_block = worklist.back();
+            worklist.pop_back();
+            splitter = blocks[splitter_block];
+
+            for (UInt c = 0; c != class_num; ++c) {
+                touched_blocks.clear();
+                for (Status_t t : splitter) {
+                    for (Status_t i = inverse_beg[c][t]; i != inverse_beg[c][t + 1]; ++i) {
+                        Status_t s = inverse[c][i];
+                        if (marked[s])
+                            continue;
+                        marked[s] = true;
+                        if (marked_count[block_of[s]]++ == 0)
+                            touched_blocks.push_back(block_of[s]);
+                    }
+                }
+
+                for (Status_t b : touched_blocks) {
+                    if (marked_count[b] != blocks[b].size()) {
+                        Vector<Status_t> in_part, out_part;
+                        for (Status_t s : blocks[b])
+                            (marked[s] ? in_part : out_part).push_back(s);
+                        Status_t new_block = blocks.size();
+                        bool keep_in = in_part.size() >= out_part.size();
+                        blocks[b] = keep_in ? std::move(in_part) : std::move(out_part);
+                        blocks.push_back(keep_in ? std::move(out_part) : std::move(in_part));
+                        for (Status_t s : blocks[new_block])
+                            block_of[s] = new_block;
+                        worklist.push_back(new_block);
+                    }
+                    marked_count[b] = 0;
+                }
+                for (Status_t t : splitter)
+                    for (Status_t i = inverse_beg[c][t]; i != inverse_beg[c][t + 1]; ++i)
+                        marked[inverse[c][i]] = false;
+            }
+        }
+
+        // the dead status is alone in the block 0, so it keeps the number 0
+        trans.resize(blocks.size() * class_num);
+        accept.resize(blocks.size());
+        for (Status_t b = 0; b != blocks.size(); ++b) {
+            Status_t represent = blocks[b].front();
+            accept[b] = subset_accept[represent];
+            for (UInt c = 0; c != class_num; ++c)
+                trans[b * class_num + c] = block_of[subset_trans[represent * class_num + c]] * class_num;
+        }
+        start = block_of[subset_start] * class_num;
+    }
+
+    Status_t start = DEAD_STATUS;
+    Status_t subset_start = DEAD_STATUS;
+    Vector<Status_t> trans;
+    Vector<bool> accept;
+    Byte_classes byte_classes;
+};
+}  // namespace pcc
+
+#endif  // DENSE_DFA_H_PCC_
@@ -0,0 +1,260 @@
+#pragma once
+#ifndef FIND_DFA_H_PCC_
+#define FIND_DFA_H_PCC_
+
+#include <algorithm>
+
+#include "byte_classes.h"
+#include "dense_dfa.h"
+#include "fa_status.h"
+#include "nfa_program.h"
+#include "pcc_config.h"
+#include "pcc_template.h"
+
+namespace pcc
+{
+using namespace fa_status;
+
+/**
+ * @brief the DFAs that find the leftmost-longest match of a regex: a forward DFA finds the end of the match,
+ *        then the DFA of the reversed regex runs back from the end to find the begin of the match
+ *
+ *
+ * The forward DFA is Basic_regex_match::find_for made into a DFA. A DFA status is the threads of the NFA
+ * grouped by the offset where they begin, the earlier group first, and a NFA status is only in the first group
+ * that reaches it. The threads that begin at the current char are the last group.
+ * When a group reaches an accept status, the groups after it are dropped and no more group is begun (closed),
+ * so the last end that the DFA accepts at is the end of the leftmost-longest match.
+ * The begin of the match is the leftmost begin of a match that ends there,
+ * the longest match of the reverse DFA (see NFA_program::reverse) that runs back from the end.
+ *
+ * Both tables have one column per Byte_classes class of the regex, like Dense_dfa,
+ * and the DFA status 0 of both is the dead status.
+ *
+ * For example, a regex: bcd|c, the string: xbcd
+ *              the forward DFA accepts at 3 (c), then at 4 (bcd) as the group that begins at 1 is before
+ *              the group of c, it dies at the end. The reverse DFA runs back from 4 and accepts at 1.
+ */
+template <typename Char_t>
+class Find_dfa
+{
+public:
+    Find_dfa() = default;
+
+    Find_dfa(const Find_dfa&) = default;
+
+    Find_dfa(Find_dfa&&) = default;
+
+    Find_dfa& operator=(const Find_dfa&) = default;
+
+    Find_dfa& operator=(Find_dfa&&) = default;
+
+    ~Find_dfa() = default;
+
+    /**
+     * @brief construct the forward DFA from the program, and the reverse DFA from its reversed program
+     *
+     * @return false if the program has counted repeats or one of the DFAs needs more than state_limit status,
+     *         the DFAs are left empty
+     */
+    bool build(const NFA_program<Char_t>& program, const Byte_classes& classes, UInt state_limit)
+    {
+        clear();
+        if (program.empty() || program.has_counters())
+            return false;
+        byte_classes = classes;
+        NFA_program<Char_t> reversed;
+        reversed.reverse(program);
+        // the reversed program has the same char ranges, so the classes of the program also split them
+        if (!subset_construct(program, state_limit) || !reverse.build(reversed, classes, state_limit)) {
+            clear();
+            return false;
+        }
+        return true;
+    }
+
+    void clear()
+    {
+        trans.clear();
+        accept.clear();
+        closes.clear();
+        reverse.clear();
+        start = DEAD_STATUS;
+    }
+
+    bool empty() const { return trans.empty(); }
+
+    /**
+     * @brief the status before the first char, only the group that begins there is in it
+     */
+    Status_t start_status() const { return start; }
+
+    Status_t next_status(Status_t status, Char_t c) const { return trans[status + byte_classes.class_of(c)]; }
+
+    /**
+     * @return true if a match ends before the char that the status is going to take
+     */
+    bool is_accept(Status_t status) const { return accept[status / byte_classes.size()]; }
+
+    /**
+     * @return the status that has the same threads, but does not begin a group at the current char or later
+     */
+    Status_t close_status(Status_t status) const { return closes[status / byte_classes.size()]; }
+
+    static bool is_dead(Status_t status) { return status == DEAD_STATUS; }
+
+    /**
+     * @return the DFA of the reversed regex, it is run from the end of the match back to its begin
+     */
+    const Dense_dfa<Char_t>& reverse_dfa() const { return reverse; }
+
+    /**
+     * @return the number of status of the forward DFA
+     */
+    size_t size() const { return accept.size(); }
+
+    /**
+     * @return the bytes of memory that the DFAs use
+     */
+    size_t memory_usage() const
+    {
+        return sizeof(*this) + trans.capacity() * sizeof(Status_t) + accept.capacity() / 8 +
+               closes.capacity() * sizeof(Status_t) + reverse.memory_usage() - sizeof(reverse);
+    }
+
+    static constexpr UInt DEFAULT_STATE_LIMIT = 1 << 12;
+    static constexpr Status_t DEAD_STATUS = 0;
+
+private:
+    static constexpr UInt OPEN = 0;
+    static constexpr UInt CLOSED = 1;
+    static constexpr UInt GROUP_END = UInt(-1);
+
+    /**
+     * @brief a DFA status is kept as OPEN or CLOSED, then the NFA status of every group followed by GROUP_END,
+     *        the last group of an OPEN status is the group that begins at the current char (it may be empty),
+     *        the dead status is kept as nothing
+     */
+    bool subset_construct(const NFA_program<Char_t>& program, UInt state_limit)
+    {
+        const UInt class_num = byte_classes.size();
+        Vector<Vector<UInt>> configs;
+        Hash_map<Vector<UInt>, Status_t, Vector_hash<UInt>> config_index;
+        auto add_config = [&](const Vector<UInt>& config) {
+            auto iter = config_index.find(config);
+            if (iter != config_index.end())
+                return iter->second;
+            const Status_t index = configs.size();
+            config_index.insert({ config, index });
+            configs.push_back(config);
+            return index;
+        };
+        add_config(Vector<UInt>());
+
+        Vector<Status_t> stamps(program.size(), 0);
+        Status_t stamp = 0;
+        Vector<UInt> from, config;
+        config.push_back(OPEN);
+        ++stamp;
+        add_group(program, program.start_status(), config, stamps, stamp);
+        start = add_config(config) * class_num;
+
+        for (Status_t index = 0; index != configs.size(); ++index) {
+            if (configs.size() > state_limit)
+                return false;
+            from = configs[index];
+            for (UInt c = 0; c != class_num; ++c) {
+                step(program, from, byte_classes.represent(c), config, stamps, stamp);
+                trans.push_back(add_config(config) * class_num);
+            }
+
+            bool accepted = false;
+            for (UInt i = 1; !from.empty() && from[0] == CLOSED && i != from.size(); ++i)
+                accepted = accepted || (from[i] != GROUP_END && program.is_accept(from[i]));
+            accept.push_back(accepted);
+
+            config = from;
+            if (!config.empty() && config[0] == OPEN) {
+                // drop the last group, the group before it (or OPEN) ends right before it
+                config.pop_back();
+                while (config.back() != GROUP_END && config.size() != 1)
+                    config.pop_back();
+                config[0] = CLOSED;
+                if (config.size() == 1)
+                    config.clear();
+            }
+            closes.push_back(add_config(config) * class_num);
+        }
+        return configs.size() <= state_limit;
+    }
+
+    /**
+     * @brief every group of from takes the char c in order, the group that reaches an accept status first
+     *        closes the status, then the group that begins after the char is added if the status is still open
+     */
+    void step(const NFA_program<Char_t>& program, const Vector<UInt>& from, Char_t c, Vector<UInt>& to,
+              Vector<Status_t>& stamps, Status_t& stamp) const
+    {
+        to.clear();
+        if (from.empty())
+            return;
+        bool closed = from[0] == CLOSED;
+        to.push_back(OPEN);
+        ++stamp;
+        for (UInt i = 1; i != from.size(); ++i) {
+            const UInt first = to.size();
+            bool accepted = false;
+            for (; from[i] != GROUP_END; ++i) {
+                program.for_each_trans(from[i], c, [&](Status_t target) {
+                    for (auto iter = program.closure_begin(target); iter != program.closure_end(target); ++iter) {
+                        if (stamps[*iter] == stamp)
+                            continue;
+                        stamps[*iter] = stamp;
+                        to.push_back(*iter);
+                        accepted = accepted || program.is_accept(*iter);
+                    }
+                });
+            }
+            if (to.size() == first)
+                continue;
+            std::sort(to.begin() + first, to.end());
+            to.push_back(GROUP_END);
+            if (accepted) {
+                closed = true;
+                break;
+            }
+        }
+        if (!closed)
+            add_group(program, program.start_status(), to, stamps, stamp);
+        to[0] = closed ? CLOSED : OPEN;
+        if (to.size() == 1)
+            to.clear();
+    }
+
+    /**
+     * @brief append the closure of the status s as a group, without the NFA status that are in the groups before it
+     */
+    static void add_group(const NFA_program<Char_t>& program, Status_t s, Vector<UInt>& config,
+                          Vector<Status_t>& stamps, Status_t stamp)
+    {
+        const UInt first = config.size();
+        for (auto iter = program.closure_begin(s); iter != program.closure_end(s); ++iter) {
+            if (stamps[*iter] == stamp)
+                continue;
+            stamps[*iter] = stamp;
+            config.push_back(*iter);
+        }
+        std::sort(config.begin() + first, config.end());
+        config.push_back(GROUP_END);
+    }
+
+    Status_t start = DEAD_STATUS;
+    Vector<Status_t> trans;
+    Vector<bool> accept;
+    Vector<Status_t> closes;
+    Byte_classes byte_classes;
+    Dense_dfa<Char_t> reverse;
+};
+}  // namespace pcc
+
+#endif  // FIND_DFA_H_PCC_
@@ -0,0 +1,247 @@
+#pragma once
+#ifndef LAZY_DFA_H_PCC_
+#define LAZY_DFA_H_PCC_
+
+#include <algorithm>
+
+#include "byte_classes.h"
+#include "fa_status.h"
+#include "nfa_program.h"
+#include "pcc_config.h"
+#include "pcc_template.h"
+#include "thread_set.h"
+
+namespace pcc
+{
+using namespace fa_status;
+
+/**
+ * @brief a DFA determinized from a NFA_program on demand
+ *
+ *
+ * Every DFA status is the union of the closures of a set of NFA status, it is created the first time it is reached
+ * and its transformations are filled in the first time they are taken.
+ * A DFA status is keyed by its NFA threads, the status with their counts (see Thread_set): the key is the sorted
+ * status if the program has no counted repeats, the sorted pairs of status and count otherwise.
+ * So the count sets of the counted repeats are a part of the DFA status, and a counted repeat with a big max
+ * is still matched by the DFA, only the DFA status that are reached are made, whatever the max is.
+ * When the cache holds more than cache_limit DFA status, the whole cache is flushed and built again
+ * from the status that is being matched.
+ *
+ * The DFA status 0 is always the dead status (the empty set of NFA status).
+ * The transformation table has one column per Byte_classes class of the regex.
+ */
+template <typename Char_t>
+class Lazy_dfa
+{
+public:
+    Lazy_dfa() : Lazy_dfa(DEFAULT_CACHE_LIMIT) {}
+
+    Lazy_dfa(UInt limit) : cache_limit(limit < MIN_CACHE_LIMIT ? MIN_CACHE_LIMIT : limit) { clear(); }
+
+    Lazy_dfa(const Lazy_dfa&) = default;
+
+    Lazy_dfa(Lazy_dfa&&) = default;
+
+    Lazy_dfa& operator=(const Lazy_dfa&) = default;
+
+    Lazy_dfa& operator=(Lazy_dfa&&) = default;
+
+    ~Lazy_dfa() = default;
+
+    void set_cache_limit(UInt limit)
+    {
+        cache_limit = limit < MIN_CACHE_LIMIT ? MIN_CACHE_LIMIT : limit;
+        clear();
+    }
+
+    UInt get_cache_limit() const { return cache_limit; }
+
+    /**
+     * @brief index the transformation table by the byte classes of a new regex, the cache is flushed
+     */
+    void reset_classes(const Byte_classes& classes)
+    {
+        byte_classes = classes;
+        clear();
+    }
+
+    const Byte_classes& get_classes() const { return byte_classes; }
+
+    /**
+     * @brief drop all the DFA status except the dead status
+     */
+    void clear()
+    {
+        trans.clear();
+        accept.clear();
+        pattern_offsets.assign(1, 0);
+        pattern_ids.clear();
+        status_sets.clear();
+        set_index.clear();
+        start = UNKNOWN_STATUS;
+        add_status(Vector<Status_t>());
+    }
+
+    /**
+     * @return the DFA status that the match begins with
+     */
+    Status_t start_status(const NFA_program<Char_t>& program)
+    {
+        if (start == UNKNOWN_STATUS) {
+            work.assign(1, { program.start_status(), 0 });
+            start = closure_to_status(program);
+        }
+        return start;
+    }
+
+    /**
+     * @return the DFA status that status trans to with char c, the cache may be flushed by the call,
+     *         so only the returned status is still valid after it
+     */
+    Status_t next_status(const NFA_program<Char_t>& program, Status_t status, Char_t c)
+    {
+        const UInt class_index = byte_classes.class_of(c);
+        Status_t target = trans[status * byte_classes.size() + class_index];
+        if (target != UNKNOWN_STATUS)
+            return target;
+
+        work.clear();
+        const Vector<Status_t>& set = status_sets[status];
+        const UInt step = program.has_counters() ? 2 : 1;
+        for (UInt i = 0; i < set.size(); i += step) {
+            const UInt count = step == 2 ? set[i + 1] : 0;
+            program.for_each_trans(set[i], c, [this, count](Status_t s) { work.push_back({ s, count }); });
+        }
+
+        size_t flush_before = flush_count;
+        target = closure_to_status(program);
+        if (flush_before == flush_count)
+            trans[status * byte_classes.size() + class_index] = target;
+        return target;
+    }
+
+    bool is_accept(Status_t status) const { return accept[status]; }
+
+    /**
+     * @return the sorted ids of the patterns that the DFA status accepts, see NFA_program::merge
+     */
+    const UInt* patterns_begin(Status_t status) const { return pattern_ids.data() + pattern_offsets[status]; }
+
+    const UInt* patterns_end(Status_t status) const { return pattern_ids.data() + pattern_offsets[status + 1]; }
+
+    static bool is_dead(Status_t status) { return status == DEAD_STATUS; }
+
+    /**
+     * @return the number of DFA status in the cache
+     */
+    size_t size() const { return status_sets.size(); }
+
+    /**
+     * @return how many times the cache has been flushed because it was full
+     */
+    size_t flush_times() const { return flush_count; }
+
+    /**
+     * @return the bytes of memory that the cache uses, the hash index counts its keys but not its buckets
+     */
+    size_t memory_usage() const
+    {
+        size_t usage = sizeof(*this) + trans.capacity() * sizeof(Status_t) + accept.capacity() / 8 +
+                       (pattern_offsets.capacity() + pattern_ids.capacity()) * sizeof(UInt) +
+                       status_sets.capacity() * sizeof(Vector<Status_t>) + work.capacity() * sizeof(work[0]) +
+                       threads.memory_usage() + sorted_threads.capacity() * sizeof(Thread_set::Thread);
+        for (const Vector<Status_t>& set : status_sets)
+            usage += 2 * set.capacity() * sizeof(Status_t);
+        return usage;
+    }
+
+    static constexpr UInt DEFAULT_CACHE_LIMIT = 1 << 12;
+    static constexpr UInt MIN_CACHE_LIMIT = 4;
+    static constexpr Status_t DEAD_STATUS = 0;
+
+private:
+    /**
+     * @brief collect the closures of the NFA status with their counts in work and turn them into a DFA status,
+     *        flush the cache first if a new DFA status is needed while the cache is full
+     */
+    Status_t closure_to_status(const NFA_program<Char_t>& program)
+    {
+        threads.reserve(program.size());
+        threads.clear();
+        for (auto& [s, count] : work) {
+            program.for_each_closure(
+                s, count, [this](Status_t status, UInt status_count) { return threads.insert(status, status_count); });
+        }
+        sorted_threads.assign(threads.begin(), threads.end());
+        std::sort(sorted_threads.begin(), sorted_threads.end(),
+                  [](const Thread_set::Thread& a, const Thread_set::Thread& b) {
+                      return a.status != b.status ? a.status < b.status : a.count < b.count;
+                  });
+        const bool with_counts = program.has_counters();
+        Vector<Status_t> closure;
+        closure.reserve(sorted_threads.size() * (with_counts ? 2 : 1));
+        for (const Thread_set::Thread& thread : sorted_threads) {
+            closure.push_back(thread.status);
+            if (with_counts)
+                closure.push_back(thread.count);
+        }
+
+        auto iter = set_index.find(closure);
+        if (iter != set_index.end())
+            return iter->second;
+        if (status_sets.size() >= cache_limit) {
+            clear();
+            ++flush_count;
+            if (closure.empty())
+                return DEAD_STATUS;
+        }
+        const size_t ids_beg = pattern_ids.size();
+        for (const Thread_set::Thread& thread : sorted_threads) {
+            if (program.is_accept(thread.status))
+                pattern_ids.push_back(program.accept_id(thread.status));
+        }
+        std::sort(pattern_ids.begin() + ids_beg, pattern_ids.end());
+        pattern_ids.erase(std::unique(pattern_ids.begin() + ids_beg, pattern_ids.end()), pattern_ids.end());
+        return add_status(std::move(closure));
+    }
+
+    /**
+     * @brief add the DFA status of the set, its pattern ids have been pushed into pattern_ids
+     */
+    Status_t add_status(Vector<Status_t>&& set)
+    {
+        Status_t new_status = status_sets.size();
+        trans.resize(trans.size() + byte_classes.size(), UNKNOWN_STATUS);
+        accept.push_back(pattern_offsets.back() != pattern_ids.size());
+        pattern_offsets.push_back(pattern_ids.size());
+        set_index.insert({ set, new_status });
+        status_sets.push_back(std::move(set));
+        return new_status;
+    }
+
+    static constexpr Status_t UNKNOWN_STATUS = Status_t(-1);
+
+    UInt cache_limit;
+    Status_t start;
+    size_t flush_count = 0;
+    Byte_classes byte_classes;
+
+    /**
+     * @brief trans[status * byte_classes.size() + class_of(c)] is the DFA status that status trans to with char c,
+     *        UNKNOWN_STATUS if it has not been computed yet
+     */
+    Vector<Status_t> trans;
+    Vector<bool> accept;
+    Vector<UInt> pattern_offsets;
+    Vector<UInt> pattern_ids;
+    Vector<Vector<Status_t>> status_sets;
+    Hash_map<Vector<Status_t>, Status_t, Vector_hash<Status_t>> set_index;
+
+    Vector<std::pair<Status_t, UInt>> work;    // the NFA status and their counts that the closures are taken from
+    Thread_set threads;
+    Vector<Thread_set::Thread> sorted_threads;
+};
+}  // namespace pcc
+
+#endif  // LAZY_DFA_H_PCC_
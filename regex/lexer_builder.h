@@ -0,0 +1,278 @@
+#pragma once
+#ifndef LEXER_BUILDER_H_PCC_
+#define LEXER_BUILDER_H_PCC_
+
+#include <algorithm>
+#include <string>
+
+#include "byte_classes.h"
+#include "fa_status.h"
+#include "lazy_dfa.h"
+#include "nfa_program.h"
+#include "pcc_config.h"
+#include "pcc_template.h"
+#include "regex.h"
+#include "stream_buffer.h"
+
+namespace pcc
+{
+using namespace fa_status;
+
+/**
+ * @brief a token that Rule_lexer emits: [offset, offset + length) from the begin of the stream
+ */
+struct Lexer_token {
+    UInt token;
+    size_t offset;
+    size_t length;
+};
+
+/**
+ * @brief build a tokenizer from rules of (regex, token, priority)
+ *
+ *
+ * The NFA of all the rules are merged under one start status by NFA_program::merge, in the order of the priority
+ * (the higher priority first, then the rule added first), so the id that an accept status has is the rank of its rule,
+ * and the rule that wins a DFA status is the one with the lowest id in it.
+ * The DFA of the merged NFA is built on demand by a Lazy_dfa of every Rule_lexer, the builder is only read
+ * by its lexers, so a built builder can be used by lexers on many threads at the same time.
+ *
+ * For example, the rules: (if, IF, 1), ([a-z]+, IDENT, 0), ([ ]+, SPACE, 0)
+ *              the input: "if iff"
+ *              the tokens: IF "if", SPACE " ", IDENT "iff"
+ */
+template <typename Char_t>
+class Basic_lexer_builder
+{
+    static_assert(is_same_v<Char_t, Char>, "Lexer_builder only support the type Char");
+
+    template <typename _Char_t, typename Stream>
+    friend class Rule_lexer;
+
+public:
+    Basic_lexer_builder() = default;
+
+    Basic_lexer_builder(const Basic_lexer_builder&) = default;
+
+    Basic_lexer_builder(Basic_lexer_builder&&) = default;
+
+    Basic_lexer_builder& operator=(const Basic_lexer_builder&) = default;
+
+    Basic_lexer_builder& operator=(Basic_lexer_builder&&) = default;
+
+    ~Basic_lexer_builder() = default;
+
+    /**
+     * @brief add a rule, the token must be less than FAILURE_TOKEN
+     *
+     * @return false if the pattern is a wrong regex, the builder is not changed
+     */
+    bool add_rule(const Char_t* pattern, UInt token, Int priority = 0)
+    {
+        Basic_regex<Char_t> regex;
+        if (!regex.regenetare_regex(pattern))
+            return false;
+        add_rule(regex, token, priority);
+        return true;
+    }
+
+    void add_rule(const Basic_regex<Char_t>& regex, UInt token, Int priority = 0)
+    {
+        assert(token < FAILURE_TOKEN);
+        rules.push_back({ regex.get_program(), token, priority });
+        built = false;
+    }
+
+    /**
+     * @brief merge the rules, it must be called after the rules are added and before the lexers are used
+     */
+    void build()
+    {
+        Vector<UInt> order(rules.size());
+        for (UInt i = 0; i != order.size(); ++i)
+            order[i] = i;
+        std::stable_sort(order.begin(), order.end(),
+                         [this](UInt a, UInt b) { return rules[a].priority > rules[b].priority; });
+
+        Vector<const NFA_program<Char_t>*> members;
+        tokens.clear();
+        for (UInt i : order) {
+            members.push_back(&rules[i].program);
+            tokens.push_back(rules[i].token);
+        }
+        program.merge(members, false);
+        byte_classes.clear();
+        program.refine_classes(byte_classes);
+        built = true;
+    }
+
+    void clear()
+    {
+        rules.clear();
+        tokens.clear();
+        program.clear();
+        byte_classes.clear();
+        built = false;
+    }
+
+    /**
+     * @return the number of the rules
+     */
+    size_t size() const { return rules.size(); }
+
+    bool is_built() const { return built; }
+
+    /**
+     * @brief set the max number of DFA status cached by the lazy DFA of every Rule_lexer made after the call
+     */
+    void set_lazy_dfa_cache_limit(UInt limit) { lazy_dfa_cache_limit = limit; }
+
+    /**
+     * @return the bytes of memory that the builder uses, the lazy DFA caches are in the Rule_lexer
+     */
+    size_t memory_usage() const
+    {
+        size_t usage = sizeof(*this) + program.memory_usage() + tokens.capacity() * sizeof(UInt);
+        for (auto& rule : rules)
+            usage += rule.program.memory_usage();
+        return usage;
+    }
+
+    /**
+     * @brief the token of the end of the stream, and of a char that no rule matches
+     */
+    static constexpr UInt END_TOKEN = UInt(-1);
+    static constexpr UInt FAILURE_TOKEN = UInt(-2);
+
+private:
+    struct Rule {
+        NFA_program<Char_t> program;
+        UInt token;
+        Int priority;
+    };
+
+    Vector<Rule> rules;
+    NFA_program<Char_t> program;
+    Vector<UInt> tokens;    // tokens[id] is the token of the rule whose accept status has the id
+    Byte_classes byte_classes;
+    UInt lazy_dfa_cache_limit = Lazy_dfa<Char_t>::DEFAULT_CACHE_LIMIT;
+    bool built = false;
+};
+
+using Lexer_builder = Basic_lexer_builder<Char>;
+
+/**
+ * @brief split the input from the specified stream into the tokens of a Basic_lexer_builder
+ *
+ *
+ * Every token is the longest prefix of the rest of the input that a rule matches (an empty match is never a token),
+ * the DFA runs forward until it dies, and the chars read after the last accept are read again for the next token,
+ * that is the only backtracking.
+ * If no rule matches, one char is emitted as FAILURE_TOKEN. END_TOKEN is emitted at the end of the stream.
+ * The stream is read by a Stream_buff, like Regex_lexer, so the input must not contain the char EOF.
+ */
+template <typename Char_t, typename Stream>
+class Rule_lexer
+{
+    static_assert(is_same_v<Char_t, Char>, "Rule_lexer only support type of Char");
+
+public:
+    using String = std::basic_string<Char_t>;
+
+    template <typename NStream>
+    Rule_lexer(const Basic_lexer_builder<Char_t>& builder, Char_t* beg, Char_t* end, NStream& stream)
+        : builder(&builder), buff(beg, end, stream), lazy_dfa(builder.lazy_dfa_cache_limit)
+    {
+        assert(builder.is_built());
+        lazy_dfa.reset_classes(builder.byte_classes);
+        buff.fill_buff();
+    }
+
+    /**
+     * @brief get the next token, its text is lexeme() until the next call
+     */
+    Lexer_token next_token()
+    {
+        text.clear();
+        size_t accept_length = 0;
+        UInt accept_token = Basic_lexer_builder<Char_t>::FAILURE_TOKEN;
+        dfa_scan(accept_length, accept_token);
+
+        if (text.empty())
+            return Lexer_token{ Basic_lexer_builder<Char_t>::END_TOKEN, offset, 0 };
+        if (accept_length == 0)
+            accept_length = 1;
+        unread(accept_length);
+        Lexer_token token{ accept_token, offset, accept_length };
+        offset += accept_length;
+        return token;
+    }
+
+    const String& lexeme() const { return text; }
+
+    static constexpr UInt BUFF_SIZE = 1 << 12;
+
+private:
+    /**
+     * @brief read the chars into text until the lazy DFA dies, the longest prefix that a rule matches
+     *        is accept_length long and has the token accept_token
+     */
+    void dfa_scan(size_t& accept_length, UInt& accept_token)
+    {
+        const NFA_program<Char_t>& program = builder->program;
+        Lazy_dfa<Char_t>& dfa = lazy_dfa;
+        Status_t status = dfa.start_status(program);
+        Char_t c;
+        while (read(c)) {
+            text.push_back(c);
+            status = dfa.next_status(program, status, c);
+            if (dfa.is_dead(status))
+                break;
+            if (dfa.is_accept(status)) {
+                accept_length = text.size();
+                accept_token = builder->tokens[*dfa.patterns_begin(status)];
+            }
+        }
+    }
+
+    bool read(Char_t& c)
+    {
+        if (pending_pos != pending.size()) {
+            c = pending[pending_pos++];
+            return true;
+        }
+        while (!at_end) {
+            c = buff.next();
+            if (c != EOF)
+                return true;
+            if (!buff.has_stream())
+                at_end = true;
+            else
+                buff.fill_buff();
+        }
+        return false;
+    }
+
+    /**
+     * @brief keep text[0, length), the chars after it are read again by the next token
+     */
+    void unread(size_t length)
+    {
+        pending.erase(0, pending_pos);
+        pending.insert(0, text, length, String::npos);
+        pending_pos = 0;
+        text.resize(length);
+    }
+
+    const Basic_lexer_builder<Char_t>* builder;
+    Stream_buff<Char_t, BUFF_SIZE, Stream> buff;
+    String text;
+    String pending;    // the chars that are read again, from pending_pos
+    size_t pending_pos = 0;
+    size_t offset = 0;
+    bool at_end = false;
+    Lazy_dfa<Char_t> lazy_dfa;    // the DFA of dfa_scan, built while the lexer runs
+};
+}  // namespace pcc
+
+#endif  // LEXER_BUILDER_H_PCC_
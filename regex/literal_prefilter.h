@@ -0,0 +1,312 @@
+#pragma once
+#ifndef LITERAL_PREFILTER_H_PCC_
+#define LITERAL_PREFILTER_H_PCC_
+
+#include <algorithm>
+#include <cstring>
+#include <string>
+#include <type_traits>
+
+#include "fa_status.h"
+#include "nfa_program.h"
+#include "pcc_config.h"
+#include "pcc_template.h"
+
+namespace pcc
+{
+using namespace fa_status;
+
+/**
+ * @brief the literals that every match of a regex must contain, found in the NFA_program at compile time
+ *
+ *
+ * prefix : every match begins with it, so a match can only begin where the prefix occurs
+ * inner  : every match contains it, so there is no match in an input that does not contain it
+ *
+ * The prefix is the chars of the status from the start status that only trans to one status with one char.
+ * The inner literal is the longest run of the status that all the matches go through (the dominators of the accept),
+ * each of them can only be reached with one char, and from the status before it in the run.
+ *
+ * For example, a regex: ERROR [0-9]+
+ *              prefix: "ERROR "
+ *
+ *              a regex: [0-9]+ms(ec)?
+ *              prefix: "", inner: "ms"
+ */
+template <typename Char_t>
+class Literal_prefilter
+{
+public:
+    using String = std::basic_string<Char_t>;
+
+    Literal_prefilter() = default;
+
+    Literal_prefilter(const Literal_prefilter&) = default;
+
+    Literal_prefilter(Literal_prefilter&&) = default;
+
+    Literal_prefilter& operator=(const Literal_prefilter&) = default;
+
+    Literal_prefilter& operator=(Literal_prefilter&&) = default;
+
+    ~Literal_prefilter() = default;
+
+    void build(const NFA_program<Char_t>& program)
+    {
+        clear();
+        if (program.empty())
+            return;
+        build_prefix(program);
+        build_inner(program);
+    }
+
+    void clear()
+    {
+        prefix_literal.clear();
+        inner_literal.clear();
+    }
+
+    bool empty() const { return prefix_literal.empty() && inner_literal.empty(); }
+
+    const String& prefix() const { return prefix_literal; }
+
+    const String& inner() const { return inner_literal; }
+
+    /**
+     * @return the offset of the first prefix in [beg + from, end), end - beg if there is no such prefix,
+     *         from if the prefix is empty
+     */
+    template <typename Iter>
+    size_t find_prefix(Iter beg, Iter end, size_t from) const
+    {
+        const size_t size = end - beg;
+        if (from >= size)
+            return size;
+        if (prefix_literal.empty())
+            return from;
+        return find_literal(beg + from, end, prefix_literal) - beg;
+    }
+
+    /**
+     * @return the offset of the first inner literal in [beg + from, end), end - beg if there is no such literal,
+     *         from if the inner literal is empty
+     */
+    template <typename Iter>
+    size_t find_inner(Iter beg, Iter end, size_t from) const
+    {
+        const size_t size = end - beg;
+        if (from >= size)
+            return size;
+        if (inner_literal.empty())
+            return from;
+        return find_literal(beg + from, end, inner_literal) - beg;
+    }
+
+    /**
+     * @return false if [beg, end) has no inner literal, so there is no match in it
+     */
+    template <typename Iter>
+    bool may_match(Iter beg, Iter end) const
+    {
+        return inner_literal.empty() || find_literal(beg, end, inner_literal) != end;
+    }
+
+    size_t memory_usage() const
+    {
+        return sizeof(*this) + (prefix_literal.capacity() + inner_literal.capacity()) * sizeof(Char_t);
+    }
+
+    /**
+     * @brief the literals are not longer than it
+     */
+    static constexpr UInt MAX_LITERAL_SIZE = 64;
+
+private:
+    template <typename Iter>
+    static Iter find_literal(Iter beg, Iter end, const String& literal)
+    {
+        if constexpr (std::is_pointer_v<Iter>) {
+            const size_t size = literal.size();
+            const Char_t first = literal[0];
+            while (size_t(end - beg) >= size) {
+                auto found = static_cast<Iter>(memchr(beg, first, end - beg - size + 1));
+                if (found == nullptr)
+                    return end;
+                if (memcmp(found + 1, literal.data() + 1, size - 1) == 0)
+                    return found;
+                beg = found + 1;
+            }
+            return end;
+        } else {
+            return std::search(beg, end, literal.begin(), literal.end());
+        }
+    }
+
+    /**
+     * @brief the prefix: follow the status from the start status while they only trans to one status with one char
+     */
+    void build_prefix(const NFA_program<Char_t>& program)
+    {
+        Status_t status = program.start_status();
+        while (prefix_literal.size() != MAX_LITERAL_SIZE) {
+            auto closure = program.closure_begin(status);
+            if (program.closure_end(status) - closure != 1 || program.is_accept(*closure))
+                return;
+            auto range = program.ranges_begin(*closure);
+            if (program.ranges_end(*closure) - range != 2 || program.range_lo(range) != program.range_hi(range))
+                return;
+            prefix_literal.push_back(Char_t(program.range_lo(range)));
+            status = program.range_target(range);
+        }
+    }
+
+    /**
+     * @brief the inner literal: the longest run of the status that all the matches go through,
+     *        and that are only reached with one char
+     *
+     *
+     * The graph has the start status and the targets of the char ranges as nodes,
+     * and a sink node that every node whose closure accepts links to.
+     * The counter status link to their targets without a char.
+     * The status that all the matches go through are the dominators of the sink,
+     * found by Cooper, Harvey and Kennedy's iterative algorithm.
+     */
+    void build_inner(const NFA_program<Char_t>& program)
+    {
+        static constexpr Status_t UNDEFINED = Status_t(-1);
+        static constexpr UInt NO_CHAR = UInt(-1);
+        static constexpr UInt MANY_CHARS = UInt(-2);
+        const Status_t start = program.start_status();
+        const Status_t sink = program.size();
+
+        // in_char[v] is the only char that v is reached with, in_from[v] is the only status that v is reached from
+        Vector<UInt> in_char(sink + 1, NO_CHAR);
+        Vector<Status_t> in_from(sink + 1, UNDEFINED);
+        Vector<Vector<Status_t>> succs(sink + 1), preds(sink + 1);
+        Vector<bool> visited(sink + 1, false);
+        Vector<Status_t> stack;
+        visited[start] = true;
+        stack.push_back(start);
+        while (!stack.empty()) {
+            Status_t node = stack.back();
+            stack.pop_back();
+            auto add_edge = [&](Status_t target) {
+                succs[node].push_back(target);
+                preds[target].push_back(node);
+                if (!visited[target]) {
+                    visited[target] = true;
+                    if (target != sink)
+                        stack.push_back(target);
+                }
+            };
+            for (auto iter = program.closure_begin(node); iter != program.closure_end(node); ++iter) {
+                if (program.is_accept(*iter))
+                    add_edge(sink);
+                // the counts of a counted repeat are not followed, the graph has all the ways that the counts allow
+                program.for_each_counter_target(*iter, [&](Status_t target) {
+                    in_char[target] = MANY_CHARS;
+                    in_from[target] = UNDEFINED;
+                    add_edge(target);
+                });
+                for (auto range = program.ranges_begin(*iter); range != program.ranges_end(*iter); range += 2) {
+                    Status_t target = program.range_target(range);
+                    if (program.closure_begin(target) == program.closure_end(target))
+                        continue;
+                    UInt c = program.range_lo(range) == program.range_hi(range) ? program.range_lo(range) : MANY_CHARS;
+                    if (in_char[target] == NO_CHAR) {
+                        in_char[target] = c;
+                        in_from[target] = node;
+                    } else {
+                        if (in_char[target] != c)
+                            in_char[target] = MANY_CHARS;
+                        if (in_from[target] != node)
+                            in_from[target] = UNDEFINED;
+                    }
+                    add_edge(target);
+                }
+            }
+        }
+        if (!visited[sink])
+            return;
+
+        // reverse postorder of the graph
+        Vector<Status_t> rpo, rpo_index(sink + 1, UNDEFINED);
+        Vector<std::pair<Status_t, UInt>> dfs;
+        std::fill(visited.begin(), visited.end(), false);
+        visited[start] = true;
+        dfs.push_back({ start, 0 });
+        while (!dfs.empty()) {
+            auto& top = dfs.back();
+            if (top.second == succs[top.first].size()) {
+                rpo.push_back(top.first);
+                dfs.pop_back();
+                continue;
+            }
+            Status_t next = succs[top.first][top.second++];
+            if (!visited[next]) {
+                visited[next] = true;
+                dfs.push_back({ next, 0 });
+            }
+        }
+        std::reverse(rpo.begin(), rpo.end());
+        for (Status_t i = 0; i != rpo.size(); ++i)
+            rpo_index[rpo[i]] = i;
+
+        Vector<Status_t> idom(sink + 1, UNDEFINED);
+        idom[start] = start;
+        auto intersect = [&](Status_t b1, Status_t b2) {
+            while (b1 != b2) {
+                while (rpo_index[b1] > rpo_index[b2])
+                    b1 = idom[b1];
+                while (rpo_index[b2] > rpo_index[b1])
+                    b2 = idom[b2];
+            }
+            return b1;
+        };
+        for (bool changed = true; changed;) {
+            changed = false;
+            for (Status_t i = 1; i < rpo.size(); ++i) {
+                Status_t node = rpo[i];
+                Status_t new_idom = UNDEFINED;
+                for (Status_t pred : preds[node]) {
+                    if (idom[pred] != UNDEFINED)
+                        new_idom = new_idom == UNDEFINED ? pred : intersect(pred, new_idom);
+                }
+                if (idom[node] != new_idom) {
+                    idom[node] = new_idom;
+                    changed = true;
+                }
+            }
+        }
+
+        // walk the dominators from the sink back to the start, the runs are collected backwards,
+        // the char of a dominator follows the char of the dominator before it if it is only reached from there
+        String run;
+        for (Status_t node = idom[sink]; node != start; node = idom[node]) {
+            if (in_char[node] >= CHAR_AMOUNT) {
+                save_inner(run);
+                continue;
+            }
+            run.push_back(Char_t(in_char[node]));
+            if (in_from[node] != idom[node])
+                save_inner(run);
+        }
+        save_inner(run);
+    }
+
+    void save_inner(String& run)
+    {
+        std::reverse(run.begin(), run.end());
+        if (run.size() > MAX_LITERAL_SIZE)
+            run.resize(MAX_LITERAL_SIZE);
+        if (run.size() > inner_literal.size())
+            inner_literal = run;
+        run.clear();
+    }
+
+    String prefix_literal;
+    String inner_literal;
+};
+}  // namespace pcc
+
+#endif  // LITERAL_PREFILTER_H_PCC_
@@ -0,0 +1,184 @@
+#pragma once
+#ifndef MATCH_SCRATCH_H_PCC_
+#define MATCH_SCRATCH_H_PCC_
+
+#include <algorithm>
+#include <cstddef>
+#include <optional>
+
+#include "byte_classes.h"
+#include "fa_status.h"
+#include "lazy_dfa.h"
+#include "nfa_program.h"
+#include "pcc_config.h"
+#include "pcc_template.h"
+#include "thread_set.h"
+
+namespace pcc
+{
+using namespace fa_status;
+
+template <typename Char_t>
+class Basic_regex;
+
+template <typename Char_t>
+class Pike_vm;
+
+template <typename Char_t>
+class Tagged_dfa;
+
+/**
+ * @brief a match found in a buffer: [offset, offset + length) from the begin of the buffer
+ *
+ * A capture group that takes no part in the match has the offset NO_OFFSET.
+ */
+struct Match_span {
+    size_t offset;
+    size_t length;
+
+    bool matched() const { return offset != NO_OFFSET; }
+
+    bool operator==(const Match_span& other) const { return offset == other.offset && length == other.length; }
+
+    bool operator!=(const Match_span& other) const { return !(*this == other); }
+
+    static constexpr size_t NO_OFFSET = size_t(-1);
+};
+
+/**
+ * @brief the working memory of the NFA simulation
+ *
+ *
+ * A caller that owns one Match_scratch per thread and passes it to match / search
+ * makes the NFA simulation allocation free once the scratch has grown to the largest regex it is used with.
+ * The engine Match_engine::LAZY_DFA caches its DFA status in the scratch too, so the regex is only read
+ * while matching. The cache is built again when the scratch is used with another regex (or Regex_set).
+ * A Match_scratch must not be used by two matches at the same time.
+ */
+template <typename Char_t>
+class Match_scratch
+{
+    template <typename _Char_t, typename Identi_action, typename Return_type>
+    friend class Basic_regex_match;
+
+    template <typename _Char_t>
+    friend class Basic_regex_set;
+
+    template <typename _Char_t>
+    friend class Basic_stream_matcher;
+
+    template <typename _Char_t>
+    friend class Pike_vm;
+
+    template <typename _Char_t>
+    friend class Tagged_dfa;
+
+public:
+    Match_scratch() = default;
+
+    Match_scratch(const Basic_regex<Char_t>& regex) { reserve(regex.get_program()); }
+
+    Match_scratch(const Match_scratch&) = default;
+
+    Match_scratch(Match_scratch&&) = default;
+
+    Match_scratch& operator=(const Match_scratch&) = default;
+
+    Match_scratch& operator=(Match_scratch&&) = default;
+
+    ~Match_scratch() = default;
+
+    /**
+     * @brief grow the scratch so that it can run the program without allocation,
+     *        the memory is O(program.size()), the counted repeats only take more when their threads are alive
+     */
+    void reserve(const NFA_program<Char_t>& program)
+    {
+        cur_threads.reserve(program.size());
+        next_threads.reserve(program.size());
+        if (cur_starts.size() < program.size()) {
+            cur_starts.resize(program.size());
+            next_starts.resize(program.size());
+        }
+    }
+
+    /**
+     * @return the bytes of memory that the scratch uses
+     */
+    size_t memory_usage() const
+    {
+        return sizeof(*this) + cur_threads.memory_usage() + next_threads.memory_usage() +
+               (cur_starts.capacity() + next_starts.capacity() + cur_slots.capacity() + next_slots.capacity() +
+                match_slots.capacity()) * sizeof(size_t) +
+               (lazy_dfa ? lazy_dfa->memory_usage() : 0) +
+               (unanchored_lazy_dfa ? unanchored_lazy_dfa->memory_usage() : 0) + failed_threads.memory_usage() -
+               sizeof(failed_threads);
+    }
+
+private:
+    /**
+     * @brief make values at least size long, the size is doubled so that a run only grows it a few times
+     */
+    static void grow(Vector<size_t>& values, size_t size)
+    {
+        if (values.size() < size)
+            values.resize(std::max(size, 2 * values.size()));
+    }
+
+    /**
+     * @return the lazy DFA cached in dfa, it is flushed if it was determinized from another program than the one
+     *         with the id (see next_lazy_dfa_id)
+     */
+    static Lazy_dfa<Char_t>& cached_lazy_dfa(std::optional<Lazy_dfa<Char_t>>& dfa, size_t& cached_id, size_t id,
+                                              UInt cache_limit, const Byte_classes& byte_classes)
+    {
+        if (!dfa)
+            dfa.emplace(cache_limit);
+        if (cached_id != id) {
+            dfa->set_cache_limit(cache_limit);
+            dfa->reset_classes(byte_classes);
+            cached_id = id;
+        }
+        return *dfa;
+    }
+
+    /**
+     * @brief the NFA threads (empty closure included) before and after the current char, see NFA_program
+     */
+    Thread_set cur_threads;
+    Thread_set next_threads;
+
+    /**
+     * @brief cur_starts[i] is the offset where the match that reaches the thread cur_threads[i] begins,
+     *        only used by find
+     */
+    Vector<size_t> cur_starts;
+    Vector<size_t> next_starts;
+
+    /**
+     * @brief the capture slots of the threads for Pike_vm,
+     *        cur_slots[i * slot_num ... (i + 1) * slot_num) for the thread cur_threads[i],
+     *        and the registers of Tagged_dfa
+     */
+    Vector<size_t> cur_slots;
+    Vector<size_t> next_slots;
+    Vector<size_t> match_slots;
+
+    /**
+     * @brief the threads that fail in the finds of a Regex_iterator before, see Failed_threads
+     */
+    Failed_threads failed_threads;
+
+    /**
+     * @brief the DFA status cached by Match_engine::LAZY_DFA, and the Basic_regex::lazy_dfa_id of the regex
+     *        that they are determinized from, a Regex_set caches its anchored program here too,
+     *        and its unanchored program in unanchored_lazy_dfa
+     */
+    std::optional<Lazy_dfa<Char_t>> lazy_dfa;
+    size_t lazy_dfa_id = 0;
+    std::optional<Lazy_dfa<Char_t>> unanchored_lazy_dfa;
+    size_t unanchored_lazy_dfa_id = 0;
+};
+}  // namespace pcc
+
+#endif  // MATCH_SCRATCH_H_PCC_
@@ -0,0 +1,109 @@
+#pragma once
+#ifndef MULTI_LITERAL_H_PCC_
+#define MULTI_LITERAL_H_PCC_
+
+#include <string>
+
+#include "aho_corasick.h"
+#include "pcc_config.h"
+#include "pcc_template.h"
+#include "teddy.h"
+
+namespace pcc
+{
+/**
+ * @brief a matcher of a set of literals, it picks Teddy or Aho_corasick for the literals
+ *
+ *
+ * Teddy is used if it has the SIMD scan and there are at most Teddy::MAX_LITERALS literals, none of them empty,
+ * otherwise the Aho_corasick automaton is used.
+ * Both of them return the leftmost-longest occurrence from find, so the choice can not be seen from the results,
+ * except the order of for_each_occurrence.
+ *
+ * For example, the literals: ERROR, WARN
+ *              a buffer: "WARN: ERROR"
+ *              find: { 0, 4, 1 }
+ */
+class Multi_literal
+{
+public:
+    Multi_literal() = default;
+
+    Multi_literal(const Multi_literal&) = default;
+
+    Multi_literal(Multi_literal&&) = default;
+
+    Multi_literal& operator=(const Multi_literal&) = default;
+
+    Multi_literal& operator=(Multi_literal&&) = default;
+
+    ~Multi_literal() = default;
+
+    /**
+     * @brief build the matcher of the literals, the literal i has the id i
+     */
+    void build(const Vector<std::string>& literals)
+    {
+        clear();
+        if (literals.empty())
+            return;
+        use_teddy = Teddy::has_simd() && teddy.build(literals);
+        if (use_teddy)
+            return;
+        for (auto& literal : literals)
+            aho_corasick.add(literal);
+        aho_corasick.build();
+    }
+
+    void clear()
+    {
+        teddy.clear();
+        aho_corasick.clear();
+        use_teddy = false;
+    }
+
+    bool empty() const { return teddy.empty() && aho_corasick.empty(); }
+
+    size_t size() const { return use_teddy ? teddy.size() : aho_corasick.size(); }
+
+    bool is_teddy() const { return use_teddy; }
+
+    /**
+     * @return the leftmost-longest occurrence in [beg + from, end), the offset is end - beg if there is none
+     */
+    template <typename Iter>
+    Literal_match find(Iter beg, Iter end, size_t from) const
+    {
+        if (empty())
+            return Literal_match{ size_t(end - beg), 0, NO_PATTERN };
+        return use_teddy ? teddy.find(beg, end, from) : aho_corasick.find(beg, end, from);
+    }
+
+    /**
+     * @brief call callback(Literal_match) for all the occurrences in [beg, end), the scan stops if callback returns false
+     */
+    template <typename Iter, typename Callback>
+    void for_each_occurrence(Iter beg, Iter end, Callback callback) const
+    {
+        if (use_teddy)
+            teddy.for_each_occurrence(beg, end, callback);
+        else if (!aho_corasick.empty())
+            aho_corasick.for_each_occurrence(beg, end, callback);
+    }
+
+    size_t memory_usage() const
+    {
+        return sizeof(*this) + teddy.memory_usage() - sizeof(teddy) + aho_corasick.memory_usage() -
+               sizeof(aho_corasick);
+    }
+
+    static constexpr UInt NO_PATTERN = UInt(-1);
+
+private:
+    Teddy teddy;
+    Aho_corasick aho_corasick;
+    bool use_teddy = false;
+};
+}  // namespace pcc
+
+#endif  // MULTI_LITERAL_H_PCC_
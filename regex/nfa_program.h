@@ -0,0 +1,690 @@
+#pragma once
+#ifndef NFA_PROGRAM_H_PCC_
+#define NFA_PROGRAM_H_PCC_
+
+#include <algorithm>
+
+#include "byte_classes.h"
+#include "fa_status.h"
+#include "pcc_config.h"
+#include "pcc_template.h"
+#include "sparse_set.h"
+
+namespace pcc
+{
+using namespace fa_status;
+
+template <typename Char_t>
+struct NFA_node;
+
+/**
+ * @brief a counted repeat X{min,max} of the nfa, it is run with a count instead of max copies of X
+ *
+ *
+ * enter : its only empty trans is to the begin of X, a thread that takes it begins X with the count 0
+ * check : the end of X has an empty trans to it, and its empty trans are to the begin of X and to the end of the repeat,
+ *         a thread that takes it has run one more X, it runs X again if the count is less than max,
+ *         and leaves the repeat if the count is not less than min
+ *
+ * For example, a regex: (ab){2,1000}
+ *                                     ___________________(again)___
+ *                                    |                            |
+ *                                    V                            |
+ *              its NFA status: 0 -> 1(enter) -> 2 -(a)-> 3 -(b)-> 4 -> 5(check) -(end)-> 6
+ */
+struct NFA_counter {
+    Status_t enter;
+    Status_t check;
+    UInt min;
+    UInt max;
+
+    static constexpr UInt NO_LIMIT = UInt(-1);    // the max of X{min,}
+};
+
+/**
+ * @brief the frozen form of a NFA: one contiguous, immutable program
+ *
+ *
+ * The empty trans are not kept, they are replaced by the empty closures computed once by freeze.
+ * The closure of a status only holds the important status (the status that have char ranges, and the accept status)
+ * that it reaches by empty trans, itself included, so a match never walks the empty trans:
+ * when it reaches a status, it takes the whole closure of the status.
+ * Only the start status and the targets of char ranges are ever reached, the other status have empty closures.
+ *
+ * All the data lives in one arena of UInt:
+ *
+ *   [ closure_offsets | range_offsets | closures | char ranges ]
+ *
+ * closure_offsets and range_offsets have size() + 1 elements, so that
+ * the closure of the status s is closures[closure_offsets[s] ... closure_offsets[s + 1]), (CSR)
+ * and the char ranges of the status s are char ranges[range_offsets[s] ... range_offsets[s + 1]).
+ *
+ * A char range takes two UInt: (lo | hi << 8) and the target status,
+ * the char ranges of a status are sorted by lo, and they may overlap after eliminate_empty_trans or merge.
+ *
+ * Every accept status has the id of the pattern it accepts, the id is 0 unless the program is merged from others.
+ *
+ * A counted repeat (see NFA_counter) is one copy of X and two counter status, so the program does not grow with max.
+ * A thread is a status with a count, the number of X that have been run in the repeat that the status is in,
+ * the status that are not in a repeat always have the count 0. The counts of X are less than max
+ * (not more than min for X{min,}, the count stops at min), a char range keeps the count of the thread.
+ * The NFA engines keep their threads in a Thread_set, which holds the counts of every status in its count set,
+ * so their memory does not grow with max.
+ * The DFA engines key a DFA status by its threads with their counts (see Lazy_dfa), so a DFA status holds
+ * the count set of every status in it, and the DFA does not number the counts up to max either.
+ * The counter status are important, the closures stop at them, and for_each_closure takes them with the count.
+ * A repeat in another repeat is copied by the parser, so a status is in one repeat at most.
+ *
+ *
+ * For example, a regex: (ab)*
+ *                               __________________
+ *                              |                 |
+ *                              |                 V
+ *              its NFA status: 0 -(a)-> 1 -(b)-> 2
+ *
+ *              its arena: [ 0 2 3 4 | 0 1 2 2 | 0 2 1 2 | 'a' | 'a' << 8, 1, 'b' | 'b' << 8, 2 ]
+ */
+template <typename Char_t>
+class NFA_program
+{
+public:
+    NFA_program() = default;
+
+    NFA_program(const NFA_program&) = default;
+
+    NFA_program(NFA_program&&) = default;
+
+    NFA_program& operator=(const NFA_program&) = default;
+
+    NFA_program& operator=(NFA_program&&) = default;
+
+    ~NFA_program() = default;
+
+    /**
+     * @brief convert the nfa into the program, the chars of every NFA_node are merged into ranges
+     *        and the empty trans are replaced by the empty closures
+     */
+    void freeze(Vector<NFA_node<Char_t>>& nfa, Status_t start, Status_t accept,
+                const Vector<NFA_counter>& nfa_counters = Vector<NFA_counter>())
+    {
+        clear();
+        const Status_t size = nfa.size();
+        if (!nfa_counters.empty())
+            counter_ops.assign(size, NO_COUNTER);
+        for (const NFA_counter& nfa_counter : nfa_counters) {
+            counter_ops[nfa_counter.enter] = counters.size() << 1;
+            counter_ops[nfa_counter.check] = counters.size() << 1 | 1;
+            Status_t body = nfa[nfa_counter.enter].get_empty_trans()[0];
+            Status_t exit = nfa[nfa_counter.check].get_empty_trans()[1];
+            counters.push_back(
+                Counter{ nfa_counter.enter, nfa_counter.check, body, exit, nfa_counter.min, nfa_counter.max });
+        }
+
+        Vector<UInt> empty_offsets(size + 1), empty_trans, range_offsets(size + 1), ranges;
+        for (Status_t s = 0; s != size; ++s) {
+            empty_offsets[s] = empty_trans.size();
+            range_offsets[s] = ranges.size() / 2;
+            auto& node = nfa[s];
+            // the empty trans of the counter status depend on the count, they are kept in the counters
+            if (!is_counter(s))
+                empty_trans.insert(empty_trans.end(), node.get_empty_trans().begin(), node.get_empty_trans().end());
+            if (node.has_trans())
+                append_ranges(node, ranges);
+        }
+        empty_offsets[size] = empty_trans.size();
+        range_offsets[size] = ranges.size() / 2;
+
+        accept_ids.assign(size, NO_PATTERN);
+        accept_ids[accept] = 0;
+        Vector<UInt> closure_offsets, closures;
+        collect_closures(size, start, empty_offsets, empty_trans, range_offsets, ranges, closure_offsets, closures);
+        assemble(size, start, closure_offsets, closures, range_offsets, ranges);
+        index_counters();
+    }
+
+    /**
+     * @brief rewrite the program so that every status has no empty trans at all
+     *
+     *
+     * Every status reachable from the start status becomes one status,
+     * which has the char ranges of all the status in its closure, and accepts if its closure accepts
+     * (the smallest pattern id in its closure).
+     * The closure of a status is then the status itself, so a step of the match is the char ranges of the status.
+     * The status numbers are changed, the start status becomes 0.
+     * A program with counted repeats is not rewritten, the counts can not be merged into the status.
+     */
+    void eliminate_empty_trans()
+    {
+        if (empty() || eliminated || has_counters())
+            return;
+
+        static constexpr Status_t NO_STATUS = Status_t(-1);
+        Vector<Status_t> new_number(status_num, NO_STATUS), old_number;
+        Vector<UInt> range_offsets(1, 0), ranges, merged;
+        Vector<UInt> new_accept_ids;
+        new_number[start_st] = 0;
+        old_number.push_back(start_st);
+
+        for (Status_t new_status = 0; new_status != old_number.size(); ++new_status) {
+            const Status_t old_status = old_number[new_status];
+            UInt accept_id = NO_PATTERN;
+            merged.clear();
+            for (auto iter = closure_begin(old_status); iter != closure_end(old_status); ++iter) {
+                accept_id = std::min(accept_id, accept_ids[*iter]);
+                for (auto range = ranges_begin(*iter); range != ranges_end(*iter); range += 2) {
+                    Status_t target = range_target(range);
+                    if (closure_begin(target) == closure_end(target))
+                        continue;
+                    if (new_number[target] == NO_STATUS) {
+                        new_number[target] = old_number.size();
+                        old_number.push_back(target);
+                    }
+                    merged.push_back(range[0]);
+                    merged.push_back(new_number[target]);
+                }
+            }
+            sort_ranges(merged);
+            ranges.insert(ranges.end(), merged.begin(), merged.end());
+            range_offsets.push_back(ranges.size() / 2);
+            new_accept_ids.push_back(accept_id);
+        }
+
+        const Status_t size = old_number.size();
+        Vector<UInt> closure_offsets(size + 1), closures(size);
+        for (Status_t s = 0; s != size; ++s) {
+            closure_offsets[s] = s;
+            closures[s] = s;
+        }
+        closure_offsets[size] = size;
+        accept_ids = std::move(new_accept_ids);
+        assemble(size, 0, closure_offsets, closures, range_offsets, ranges);
+        eliminated = true;
+    }
+
+    /**
+     * @brief merge the programs into one program under a new start status 0,
+     *        the accept status of programs[i] accept the pattern id i
+     *
+     *
+     * anchored   : the closure of the new start status is the closures of all the start status,
+     *              so a match of the program begins at the begin of the input
+     * unanchored : the new start status trans to itself with every char, and it also has the char ranges of
+     *              the closures of all the start status, so a match can begin at any char, but is never empty
+     */
+    void merge(const Vector<const NFA_program*>& programs, bool unanchored)
+    {
+        clear();
+        Vector<UInt> closures, ranges;
+        Sparse_set threads;
+        Status_t base = 1;
+        for (const NFA_program* program : programs) {
+            Status_t start = program->start_status();
+            for (auto iter = program->closure_begin(start); iter != program->closure_end(start); ++iter)
+                closures.push_back(base + *iter);
+            // the threads with a count are left out, X can match the empty string there,
+            // and the same status with the count 0 is in the closure, which can do all that they can do
+            threads.reserve(program->size());
+            threads.clear();
+            program->for_each_closure(start, 0, [&](Status_t status, UInt count) {
+                if (count != 0 || !threads.insert(status))
+                    return false;
+                for (auto range = program->ranges_begin(status); range != program->ranges_end(status); range += 2) {
+                    ranges.push_back(range[0]);
+                    ranges.push_back(base + range_target(range));
+                }
+                return true;
+            });
+            base += program->size();
+        }
+        if (unanchored) {
+            closures.assign(1, 0);
+            ranges.push_back(make_range(0, UChar(CHAR_AMOUNT - 1)));
+            ranges.push_back(0);
+            sort_ranges(ranges);
+        } else {
+            ranges.clear();
+        }
+
+        Vector<UInt> closure_offsets{ 0, UInt(closures.size()) }, range_offsets{ 0, UInt(ranges.size() / 2) };
+        Vector<UInt> new_accept_ids(1, NO_PATTERN);
+        base = 1;
+        for (UInt id = 0; id != programs.size(); ++id) {
+            const NFA_program& program = *programs[id];
+            for (Status_t s = 0; s != program.size(); ++s) {
+                for (auto iter = program.closure_begin(s); iter != program.closure_end(s); ++iter)
+                    closures.push_back(base + *iter);
+                closure_offsets.push_back(closures.size());
+                for (auto range = program.ranges_begin(s); range != program.ranges_end(s); range += 2) {
+                    ranges.push_back(range[0]);
+                    ranges.push_back(base + range_target(range));
+                }
+                range_offsets.push_back(ranges.size() / 2);
+                new_accept_ids.push_back(program.is_accept(s) ? id : NO_PATTERN);
+            }
+            for (const Counter& counter : program.counters) {
+                counters.push_back(Counter{ base + counter.enter, base + counter.check, base + counter.body,
+                                            base + counter.exit, counter.min, counter.max });
+            }
+            base += program.size();
+        }
+
+        if (!counters.empty()) {
+            counter_ops.assign(base, NO_COUNTER);
+            for (UInt index = 0; index != counters.size(); ++index) {
+                counter_ops[counters[index].enter] = index << 1;
+                counter_ops[counters[index].check] = index << 1 | 1;
+            }
+        }
+        accept_ids = std::move(new_accept_ids);
+        assemble(base, 0, closure_offsets, closures, range_offsets, ranges);
+        index_counters();
+    }
+
+    /**
+     * @brief build the reversed program of other, it matches the reversed strings of the matches of other
+     *
+     *
+     * The edges of other are flipped: a char range s -(c)-> t becomes t -(c)-> s,
+     * and every status u in the closure of t has an empty trans to t.
+     * The new start status is other.size(), it has empty trans to the accept status of other,
+     * and the start status of other is the only accept status (with the pattern id 0).
+     * Then the closures are collected again as freeze does.
+     * A program with counted repeats is not reversed, the program is left empty.
+     *
+     * For example, a regex: ab*
+     *
+     *              its NFA status: 0 -(a)-> 1 -(b)-> 1, 1 accepts
+     *
+     *              the reversed:    2 -> 1, 1 -(b)-> 1, 1 -(a)-> 0, 0 accepts
+     */
+    void reverse(const NFA_program& other)
+    {
+        clear();
+        if (other.empty() || other.has_counters())
+            return;
+
+        const Status_t start = other.size();
+        const Status_t size = start + 1;
+        Vector<Vector<UInt>> empty_lists(size), range_lists(size);
+        for (Status_t s = 0; s != other.size(); ++s) {
+            if (other.is_accept(s))
+                empty_lists[start].push_back(s);
+            for (auto iter = other.closure_begin(s); iter != other.closure_end(s); ++iter) {
+                if (*iter != s)
+                    empty_lists[*iter].push_back(s);
+            }
+            for (auto range = other.ranges_begin(s); range != other.ranges_end(s); range += 2) {
+                range_lists[range_target(range)].push_back(range[0]);
+                range_lists[range_target(range)].push_back(s);
+            }
+        }
+
+        Vector<UInt> empty_offsets(size + 1), empty_trans, range_offsets(size + 1), ranges;
+        for (Status_t s = 0; s != size; ++s) {
+            empty_offsets[s] = empty_trans.size();
+            range_offsets[s] = ranges.size() / 2;
+            empty_trans.insert(empty_trans.end(), empty_lists[s].begin(), empty_lists[s].end());
+            sort_ranges(range_lists[s]);
+            ranges.insert(ranges.end(), range_lists[s].begin(), range_lists[s].end());
+        }
+        empty_offsets[size] = empty_trans.size();
+        range_offsets[size] = ranges.size() / 2;
+
+        accept_ids.assign(size, NO_PATTERN);
+        accept_ids[other.start_status()] = 0;
+        Vector<UInt> closure_offsets, closures;
+        collect_closures(size, start, empty_offsets, empty_trans, range_offsets, ranges, closure_offsets, closures);
+        assemble(size, start, closure_offsets, closures, range_offsets, ranges);
+    }
+
+    /**
+     * @brief split the classes so that no transformation of the program can tell apart two chars in a class
+     *
+     *
+     * The ranges of a status may overlap, so the classes are refined once for every target of the status:
+     * keys[c] = 1 if c trans to the target.
+     */
+    void refine_classes(Byte_classes& classes) const
+    {
+        Status_t keys[CHAR_AMOUNT];
+        Vector<Status_t> targets;
+        for (Status_t s = 0; s != status_num; ++s) {
+            targets.clear();
+            for (auto range = ranges_begin(s); range != ranges_end(s); range += 2)
+                targets.push_back(range_target(range));
+            std::sort(targets.begin(), targets.end());
+            targets.erase(std::unique(targets.begin(), targets.end()), targets.end());
+
+            for (Status_t target : targets) {
+                std::fill(keys, keys + CHAR_AMOUNT, 0);
+                for (auto range = ranges_begin(s); range != ranges_end(s); range += 2) {
+                    if (range_target(range) != target)
+                        continue;
+                    for (UInt c = range_lo(range); c <= range_hi(range); ++c)
+                        keys[c] = 1;
+                }
+                classes.refine(keys);
+            }
+        }
+    }
+
+    void clear()
+    {
+        arena.clear();
+        accept_ids.clear();
+        counters.clear();
+        counter_ops.clear();
+        status_num = 0;
+        closure_beg = 0;
+        range_beg = 0;
+        start_st = 0;
+        eliminated = false;
+    }
+
+    bool empty() const { return status_num == 0; }
+
+    /**
+     * @return the number of status
+     */
+    Status_t size() const { return status_num; }
+
+    Status_t start_status() const { return start_st; }
+
+    bool is_accept(Status_t s) const { return accept_ids[s] != NO_PATTERN; }
+
+    /**
+     * @return the id of the pattern that the status accepts, NO_PATTERN if it does not accept
+     */
+    UInt accept_id(Status_t s) const { return accept_ids[s]; }
+
+    /**
+     * @return true if the program has counted repeats, see NFA_counter
+     */
+    bool has_counters() const { return !counters.empty(); }
+
+    /**
+     * @return true if eliminate_empty_trans has been called since the last freeze
+     */
+    bool is_eliminated() const { return eliminated; }
+
+    /**
+     * @return the important status in the empty closure of the status s
+     */
+    const UInt* closure_begin(Status_t s) const { return arena.data() + closure_beg + arena[s]; }
+
+    const UInt* closure_end(Status_t s) const { return arena.data() + closure_beg + arena[s + 1]; }
+
+    /**
+     * @return the char ranges of the status s, two UInt for each range
+     */
+    const UInt* ranges_begin(Status_t s) const { return arena.data() + range_beg + 2 * arena[status_num + 1 + s]; }
+
+    const UInt* ranges_end(Status_t s) const { return arena.data() + range_beg + 2 * arena[status_num + 2 + s]; }
+
+    bool has_trans(Status_t s) const { return arena[status_num + 1 + s] != arena[status_num + 2 + s]; }
+
+    static UChar range_lo(const UInt* range) { return UChar(range[0]); }
+
+    static UChar range_hi(const UInt* range) { return UChar(range[0] >> 8); }
+
+    static Status_t range_target(const UInt* range) { return range[1]; }
+
+    static UInt make_range(UChar lo, UChar hi) { return UInt(lo) | (UInt(hi) << 8); }
+
+    /**
+     * @brief call fn(target) for every status that the status s trans to with char c
+     */
+    template <typename Fn>
+    void for_each_trans(Status_t s, Char_t c, Fn fn) const
+    {
+        const UChar uc = UChar(c);
+        for (const UInt *range = ranges_begin(s), *end = ranges_end(s); range != end; range += 2) {
+            if (range_lo(range) > uc)
+                break;
+            if (uc <= range_hi(range))
+                fn(range_target(range));
+        }
+    }
+
+    /**
+     * @brief call insert(status, count) for every thread in the closure of the status s with the count,
+     *        insert returns true if the thread is new, then the counter status in it are taken
+     *
+     *
+     * A thread at enter takes the begin of X with the count 0.
+     * A thread at check has run count + 1 X, it takes the end of the repeat if count + 1 >= min,
+     * and the begin of X with count + 1 if count + 1 < max.
+     * If X can match the empty string, the check reached again from that begin of X is not taken again,
+     * the threads with count + 2 can only do what the threads with count + 1 do (min is 0 then).
+     */
+    template <typename Insert>
+    void for_each_closure(Status_t s, UInt count, Insert insert) const
+    {
+        if (counters.empty()) {
+            for (auto iter = closure_begin(s); iter != closure_end(s); ++iter)
+                insert(*iter, 0);
+            return;
+        }
+        close_counted(s, count, NO_COUNTER, insert);
+    }
+
+    /**
+     * @brief call fn(target) for every status that the counter status s may take with an empty trans
+     */
+    template <typename Fn>
+    void for_each_counter_target(Status_t s, Fn fn) const
+    {
+        if (!is_counter(s))
+            return;
+        const Counter& counter = counters[counter_ops[s] >> 1];
+        fn(counter.body);
+        if (s == counter.check)
+            fn(counter.exit);
+    }
+
+    bool is_counter(Status_t s) const { return !counter_ops.empty() && counter_ops[s] != NO_COUNTER; }
+
+    /**
+     * @brief call fn(target, count, no_loop) for the closures that the thread of the counter status s takes,
+     *        the begin of X again before the end of the repeat, so a match prefers more X (greedy)
+     *
+     * @param no_loop the counter that may not run X again, NO_COUNTER if none, see for_each_closure;
+     *                the closure of the target is taken with the no_loop passed to fn
+     */
+    template <typename Fn>
+    void for_each_counter_step(Status_t s, UInt count, UInt no_loop, Fn fn) const
+    {
+        const UInt index = counter_ops[s] >> 1;
+        const Counter& counter = counters[index];
+        if (s == counter.enter) {
+            fn(counter.body, 0, NO_COUNTER);
+            return;
+        }
+        const UInt next = counter.max == NFA_counter::NO_LIMIT ? std::min(count + 1, counter.min) : count + 1;
+        if (next < counter.max && index != no_loop)
+            fn(counter.body, next, counter.nullable ? index : NO_COUNTER);
+        if (next >= counter.min)
+            fn(counter.exit, 0, NO_COUNTER);
+    }
+
+    /**
+     * @return the bytes of memory that the program uses
+     */
+    size_t memory_usage() const
+    {
+        return sizeof(*this) +
+               (arena.capacity() + accept_ids.capacity() + counter_ops.capacity()) * sizeof(UInt) +
+               counters.capacity() * sizeof(Counter);
+    }
+
+    static constexpr UInt NO_PATTERN = UInt(-1);
+    static constexpr UInt NO_COUNTER = UInt(-1);
+
+private:
+    /**
+     * @brief a counted repeat of the program, the count of a thread in X is the number of X that have been run
+     */
+    struct Counter {
+        Status_t enter;
+        Status_t check;
+        Status_t body;    // the begin of X
+        Status_t exit;    // the end of the repeat
+        UInt min;
+        UInt max;
+        bool nullable = false;    // X can match the empty string
+    };
+
+    template <typename Insert>
+    void close_counted(Status_t s, UInt count, UInt no_loop, Insert& insert) const
+    {
+        for (auto iter = closure_begin(s); iter != closure_end(s); ++iter) {
+            const Status_t status = *iter;
+            if (!insert(status, count) || !is_counter(status))
+                continue;
+            for_each_counter_step(status, count, no_loop, [&](Status_t target, UInt target_count, UInt target_no_loop) {
+                close_counted(target, target_count, target_no_loop, insert);
+            });
+        }
+    }
+
+    /**
+     * @brief find the counters whose X can match the empty string,
+     *        X{min,max} is the same as X{0,max} then, so min becomes 0
+     */
+    void index_counters()
+    {
+        for (Counter& counter : counters) {
+            counter.nullable = std::find(closure_begin(counter.body), closure_end(counter.body), counter.check) !=
+                               closure_end(counter.body);
+            if (counter.nullable)
+                counter.min = 0;
+        }
+    }
+
+    static void append_ranges(NFA_node<Char_t>& node, Vector<UInt>& ranges)
+    {
+        static constexpr Status_t NO_TRANS = Status_t(-1);
+        if (node.get_node_type() == NFA_node<Char_t>::COMMON_NODE) {
+            // only the chars in the hash map have a trans, so they are sorted instead of looking up all the chars
+            Vector<std::pair<UChar, Status_t>> trans;
+            for (auto& [c, target] : node.get_trans())
+                trans.push_back({ UChar(c), target });
+            std::sort(trans.begin(), trans.end());
+            for (UInt i = 0; i != trans.size(); ++i) {
+                if (i != 0 && trans[i].first == trans[i - 1].first + 1 && trans[i].second == trans[i - 1].second) {
+                    ranges[ranges.size() - 2] = make_range(range_lo(&ranges[ranges.size() - 2]), trans[i].first);
+                } else {
+                    ranges.push_back(make_range(trans[i].first, trans[i].first));
+                    ranges.push_back(trans[i].second);
+                }
+            }
+            return;
+        }
+
+        Status_t last_target = NO_TRANS;
+        for (UInt c = 0; c != CHAR_AMOUNT; ++c) {
+            auto result = node.trans_to(Char_t(c));
+            Status_t target = result.first ? result.second : NO_TRANS;
+            if (target == last_target && target != NO_TRANS) {
+                ranges[ranges.size() - 2] = make_range(range_lo(&ranges[ranges.size() - 2]), UChar(c));
+            } else if (target != NO_TRANS) {
+                ranges.push_back(make_range(UChar(c), UChar(c)));
+                ranges.push_back(target);
+            }
+            last_target = target;
+        }
+    }
+
+    /**
+     * @brief collect the closures of the start status and of every target of the char ranges
+     */
+    void collect_closures(Status_t size, Status_t start, const Vector<UInt>& empty_offsets,
+                          const Vector<UInt>& empty_trans, const Vector<UInt>& range_offsets,
+                          const Vector<UInt>& ranges, Vector<UInt>& closure_offsets, Vector<UInt>& closures) const
+    {
+        Vector<bool> reached(size, false);
+        reached[start] = true;
+        for (UInt i = 1; i < ranges.size(); i += 2)
+            reached[ranges[i]] = true;
+        for (const Counter& counter : counters)
+            reached[counter.body] = reached[counter.exit] = true;
+
+        // visited[s] == root + 1 if s is in the closure of root
+        Vector<Status_t> visited(size, 0);
+        Vector<Status_t> stack;
+        closure_offsets.resize(size + 1);
+        for (Status_t root = 0; root != size; ++root) {
+            closure_offsets[root] = closures.size();
+            if (!reached[root])
+                continue;
+            auto first = closures.size();
+            visited[root] = root + 1;
+            stack.push_back(root);
+            while (!stack.empty()) {
+                Status_t s = stack.back();
+                stack.pop_back();
+                if (accept_ids[s] != NO_PATTERN || range_offsets[s] != range_offsets[s + 1] || is_counter(s))
+                    closures.push_back(s);
+                for (UInt i = empty_offsets[s]; i != empty_offsets[s + 1]; ++i) {
+                    if (visited[empty_trans[i]] == root + 1)
+                        continue;
+                    visited[empty_trans[i]] = root + 1;
+                    stack.push_back(empty_trans[i]);
+                }
+            }
+            std::sort(closures.begin() + first, closures.end());
+        }
+        closure_offsets[size] = closures.size();
+    }
+
+    /**
+     * @brief sort the ranges by (lo, hi, target) and remove the same ranges
+     */
+    static void sort_ranges(Vector<UInt>& ranges)
+    {
+        using Range = std::pair<UInt, UInt>;
+        Vector<Range> pairs;
+        for (UInt i = 0; i != ranges.size(); i += 2)
+            pairs.push_back({ ranges[i], ranges[i + 1] });
+        std::sort(pairs.begin(), pairs.end(), [](const Range& r1, const Range& r2) {
+            UInt key1 = (r1.first & 0xff) << 8 | r1.first >> 8, key2 = (r2.first & 0xff) << 8 | r2.first >> 8;
+            return key1 != key2 ? key1 < key2 : r1.second < r2.second;
+        });
+        pairs.erase(std::unique(pairs.begin(), pairs.end()), pairs.end());
+        ranges.clear();
+        for (auto& range : pairs) {
+            ranges.push_back(range.first);
+            ranges.push_back(range.second);
+        }
+    }
+
+    void assemble(Status_t size, Status_t start, const Vector<UInt>& closure_offsets, const Vector<UInt>& closures,
+                  const Vector<UInt>& range_offsets, const Vector<UInt>& ranges)
+    {
+        status_num = size;
+        start_st = start;
+        arena.clear();
+        arena.insert(arena.end(), closure_offsets.begin(), closure_offsets.end());
+        arena.insert(arena.end(), range_offsets.begin(), range_offsets.end());
+        closure_beg = arena.size();
+        arena.insert(arena.end(), closures.begin(), closures.end());
+        range_beg = arena.size();
+        arena.insert(arena.end(), ranges.begin(), ranges.end());
+        arena.shrink_to_fit();
+        accept_ids.shrink_to_fit();
+    }
+
+    Vector<UInt> arena;
+    Vector<UInt> accept_ids;
+    Vector<Counter> counters;
+    Vector<UInt> counter_ops;       // counter_ops[s] is index << 1 if s is the enter of counters[index], index << 1 | 1 for
+                                    // its check, NO_COUNTER for the other status, empty without counters
+    Status_t status_num = 0;
+    UInt closure_beg = 0;
+    UInt range_beg = 0;
+    Status_t start_st = 0;
+    bool eliminated = false;
+};
+}  // namespace pcc
+
+#endif  // NFA_PROGRAM_H_PCC_
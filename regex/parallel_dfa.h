@@ -0,0 +1,330 @@
+#pragma once
+#ifndef PARALLEL_DFA_H_PCC_
+#define PARALLEL_DFA_H_PCC_
+
+#include <algorithm>
+#include <cstddef>
+
+#include "dense_dfa.h"
+#include "fa_status.h"
+#include "pcc_config.h"
+#include "pcc_template.h"
+#include "regex.h"
+#include "thread_pool.h"
+
+namespace pcc
+{
+using namespace fa_status;
+
+/**
+ * @brief match / search over one long input by chunks on the threads of a Thread_pool, with the Dense_dfa of a regex
+ *
+ *
+ * The status that the DFA is in at the begin of a chunk is not known until the chunks before it are run,
+ * so every chunk is run from all the status it may begin with, and the result of a chunk is a function:
+ * the status it begins with -> (the status it ends with, the last accept in it, where the DFA dies in it).
+ * The functions of the chunks are composed in order from the start status, that only looks up one entry per chunk.
+ * This fold is not a parallel prefix composition, and it does not need to be: the result of the composition
+ * is only wanted for the start status, so a step of the fold is a lookup of one entry (a few entries after the
+ * speculation), while a step of a parallel prefix scan would compose two whole functions.
+ * There are about 4 chunks for each thread, so the fold is a few hundred lookups after the O(size) runs
+ * of the chunks, and a scan would only pay off with many thousands of chunks.
+ * The fold gives the same result as the sequential run: the status that the run is in at the begin of a chunk
+ * is always one of the entries of the chunk (the speculation runs all the status over the chars before it).
+ *
+ * The status a chunk may begin with are speculated from the LOOKBACK chars before it:
+ * all the status are run over them, and most DFA forget where they were after a few chars,
+ * so usually only one or two status are left. The runs of a chunk are done in lockstep,
+ * and two runs that reach the same status at the same char are merged, because the rest of them are the same.
+ * If the DFA never forgets (for example, it counts the chars), the chunk is run from every status that is left.
+ *
+ * The results are the same as regex_match / regex_search with Match_engine::DFA.
+ * If the regex has no DFA (Basic_regex::compile_dfa is not called or fails), the NFA is run on one thread.
+ *
+ * For example, a regex: [a-z]*(ab|cd)
+ *              chunks: "xxab", "cdyy", the status before "cdyy" is the one after "ab", the same for any status before "xx"
+ */
+class Parallel_dfa
+{
+public:
+    /**
+     * @param min_chunk_size the chunks are not shorter than it, except the last one
+     */
+    Parallel_dfa(Thread_pool& pool, size_t min_chunk_size = DEFAULT_MIN_CHUNK_SIZE)
+        : pool(&pool), min_chunk_size(std::max<size_t>(min_chunk_size, 1)), scratches(pool.size())
+    {
+    }
+
+    Parallel_dfa(const Parallel_dfa&) = default;
+
+    Parallel_dfa& operator=(const Parallel_dfa&) = default;
+
+    ~Parallel_dfa() = default;
+
+    /**
+     * @brief the same as regex_match(regex, beg, end, Match_engine::DFA)
+     */
+    std::pair<const Char*, bool> match(const Regex& regex, const Char* beg, const Char* end)
+    {
+        if (!regex.has_dfa())
+            return regex_match(regex, beg, end);
+
+        const Dense_dfa<Char>& dfa = regex.get_dfa();
+        Lane_end result = run(dfa, beg, end);
+        if (result.dead_at != NO_POS)
+            return { beg + result.dead_at, false };
+        return { end, dfa.is_accept(result.status) };
+    }
+
+    /**
+     * @brief the same as regex_search(regex, beg, end, Match_engine::DFA)
+     */
+    std::pair<const Char*, size_t> search(const Regex& regex, const Char* beg, const Char* end)
+    {
+        if (!regex.has_dfa())
+            return regex_search(regex, beg, end);
+
+        Lane_end result = run(regex.get_dfa(), beg, end);
+        const size_t cursor = result.dead_at != NO_POS ? result.dead_at : end - beg;
+        if (result.last_accept != NO_POS)
+            return { beg + result.last_accept, cursor };
+        return { beg + cursor, 0 };
+    }
+
+    static constexpr size_t DEFAULT_MIN_CHUNK_SIZE = 1 << 16;
+    static constexpr size_t LOOKBACK = 256;
+
+private:
+    static constexpr size_t NO_POS = size_t(-1);
+    static constexpr UInt NO_LANE = UInt(-1);
+
+    /**
+     * @brief where a run ends, the offsets are from the begin of the input
+     */
+    struct Lane_end {
+        Status_t status;
+        size_t last_accept;    // the offset after the last char that the run accepts at, NO_POS if none
+        size_t dead_at;        // the offset of the char that the run dies at, NO_POS if it is alive at the end
+    };
+
+    /**
+     * @brief the function of a chunk: the run from entries[i] ends at ends[i]
+     */
+    struct Chunk_result {
+        Vector<Status_t> entries;
+        Vector<Lane_end> ends;
+    };
+
+    /**
+     * @brief the memory that a thread runs the lanes in, stamps[index] == stamp if a lane is in the status now
+     */
+    struct Lane_scratch {
+        Vector<size_t> stamps;
+        Vector<UInt> owners;
+        Vector<UInt> active;
+        Vector<UInt> merged_to;
+        Vector<size_t> merged_at;
+        size_t stamp = 0;
+    };
+
+    /**
+     * @brief run the DFA over [beg, end) by chunks, and compose the functions of the chunks from the start status
+     */
+    Lane_end run(const Dense_dfa<Char>& dfa, const Char* beg, const Char* end)
+    {
+        split(end - beg);
+        const size_t chunk_num = bounds.size() - 1;
+        chunk_results.resize(chunk_num);
+        pool->run(chunk_num, [&](size_t chunk, UInt thread_index) {
+            run_chunk(dfa, beg, chunk, scratches[thread_index]);
+        });
+
+        Lane_end result{ dfa.start_status(), NO_POS, NO_POS };
+        for (size_t chunk = 0; chunk != chunk_num; ++chunk) {
+            const Chunk_result& chunk_result = chunk_results[chunk];
+            auto iter = std::find(chunk_result.entries.begin(), chunk_result.entries.end(), result.status);
+            assert(iter != chunk_result.entries.end());
+            const Lane_end& lane_end = chunk_result.ends[iter - chunk_result.entries.begin()];
+            result.status = lane_end.status;
+            result.dead_at = lane_end.dead_at;
+            if (lane_end.last_accept != NO_POS)
+                result.last_accept = lane_end.last_accept;
+            if (result.dead_at != NO_POS)
+                break;
+        }
+        return result;
+    }
+
+    /**
+     * @brief bounds = the offsets that the chunks begin at, and the size, about 4 chunks for each thread
+     */
+    void split(size_t size)
+    {
+        bounds.assign(1, 0);
+        if (pool->size() > 1) {
+            const size_t chunk_size = std::max(min_chunk_size, size / (size_t(pool->size()) * 4) + 1);
+            while (bounds.back() + chunk_size < size)
+                bounds.push_back(bounds.back() + chunk_size);
+        }
+        bounds.push_back(size);
+    }
+
+    void run_chunk(const Dense_dfa<Char>& dfa, const Char* beg, size_t chunk, Lane_scratch& scratch)
+    {
+        Chunk_result& chunk_result = chunk_results[chunk];
+        const size_t chunk_beg = bounds[chunk];
+        speculate(dfa, beg, chunk_beg, scratch, chunk_result.entries);
+
+        const Vector<Status_t>& entries = chunk_result.entries;
+        Vector<Lane_end>& ends = chunk_result.ends;
+        const UInt lane_num = UInt(entries.size());
+        ends.resize(lane_num);
+        scratch.active.resize(lane_num);
+        scratch.merged_to.assign(lane_num, NO_LANE);
+        scratch.merged_at.resize(lane_num);
+        for (UInt lane = 0; lane != lane_num; ++lane) {
+            ends[lane] = Lane_end{ entries[lane], NO_POS, NO_POS };
+            scratch.active[lane] = lane;
+        }
+
+        Vector<UInt>& active = scratch.active;
+        size_t pos = chunk_beg;
+        const size_t chunk_end = bounds[chunk + 1];
+        for (; pos != chunk_end && active.size() > 1; ++pos) {
+            const Char c = beg[pos];
+            const size_t stamp = new_stamp(dfa, scratch);
+            size_t kept = 0;
+            for (UInt lane : active) {
+                Lane_end& lane_end = ends[lane];
+                Status_t status = dfa.next_status(lane_end.status, c);
+                if (dfa.is_dead(status)) {
+                    lane_end.dead_at = pos;
+                    continue;
+                }
+                if (dfa.is_accept(status))
+                    lane_end.last_accept = pos + 1;
+                lane_end.status = status;
+
+                const size_t index = dfa.index_of(status);
+                if (scratch.stamps[index] == stamp) {
+                    scratch.merged_to[lane] = scratch.owners[index];
+                    scratch.merged_at[lane] = pos + 1;
+                    continue;
+                }
+                scratch.stamps[index] = stamp;
+                scratch.owners[index] = lane;
+                active[kept++] = lane;
+            }
+            active.resize(kept);
+        }
+
+        // only one lane is left, the same loop as Basic_regex_match::dfa_search_for
+        if (active.size() == 1) {
+            Lane_end& lane_end = ends[active[0]];
+            Status_t status = lane_end.status;
+            size_t last_accept = lane_end.last_accept;
+            for (; pos != chunk_end; ++pos) {
+                status = dfa.next_status(status, beg[pos]);
+                if (dfa.is_dead(status)) {
+                    lane_end.dead_at = pos;
+                    break;
+                }
+                if (dfa.is_accept(status))
+                    last_accept = pos + 1;
+            }
+            lane_end.status = status;
+            lane_end.last_accept = last_accept;
+        }
+
+        for (UInt lane = 0; lane != lane_num; ++lane)
+            resolve(lane, ends, scratch);
+    }
+
+    /**
+     * @brief entries = the status that the DFA may be in at chunk_beg, the dead status is left out
+     */
+    void speculate(const Dense_dfa<Char>& dfa, const Char* beg, size_t chunk_beg, Lane_scratch& scratch,
+                   Vector<Status_t>& entries)
+    {
+        entries.clear();
+        size_t pos = 0;
+        if (chunk_beg <= LOOKBACK) {
+            entries.push_back(dfa.start_status());
+        } else {
+            pos = chunk_beg - LOOKBACK;
+            for (size_t index = 1; index != dfa.size(); ++index)
+                entries.push_back(dfa.status_of(index));
+        }
+
+        for (; pos != chunk_beg && !entries.empty(); ++pos) {
+            const size_t stamp = new_stamp(dfa, scratch);
+            size_t kept = 0;
+            for (Status_t status : entries) {
+                status = dfa.next_status(status, beg[pos]);
+                const size_t index = dfa.index_of(status);
+                if (dfa.is_dead(status) || scratch.stamps[index] == stamp)
+                    continue;
+                scratch.stamps[index] = stamp;
+                entries[kept++] = status;
+            }
+            entries.resize(kept);
+        }
+    }
+
+    /**
+     * @brief a lane merged into another one ends where that one ends,
+     *        and its last accept is the one of that lane if it is after the merge
+     */
+    static void resolve(UInt lane, Vector<Lane_end>& ends, Lane_scratch& scratch)
+    {
+        const UInt target = scratch.merged_to[lane];
+        if (target == NO_LANE)
+            return;
+        resolve(target, ends, scratch);
+        const Lane_end& target_end = ends[target];
+        ends[lane].status = target_end.status;
+        ends[lane].dead_at = target_end.dead_at;
+        if (target_end.last_accept != NO_POS && target_end.last_accept >= scratch.merged_at[lane])
+            ends[lane].last_accept = target_end.last_accept;
+        scratch.merged_to[lane] = NO_LANE;
+    }
+
+    static size_t new_stamp(const Dense_dfa<Char>& dfa, Lane_scratch& scratch)
+    {
+        if (scratch.stamps.size() != dfa.size()) {
+            scratch.stamps.assign(dfa.size(), 0);
+            scratch.owners.resize(dfa.size());
+            scratch.stamp = 0;
+        }
+        return ++scratch.stamp;
+    }
+
+    Thread_pool* pool;
+    size_t min_chunk_size;
+    Vector<Lane_scratch> scratches;    // scratches[thread_index]
+    Vector<size_t> bounds;
+    Vector<Chunk_result> chunk_results;
+};
+
+/**
+ * @brief regex_match(regex, beg, end, Match_engine::DFA) on the threads of the pool
+ */
+inline std::pair<const Char*, bool> parallel_regex_match(const Regex& regex, const Char* beg, const Char* end,
+                                                         Thread_pool& pool)
+{
+    Parallel_dfa parallel_dfa(pool);
+    return parallel_dfa.match(regex, beg, end);
+}
+
+/**
+ * @brief regex_search(regex, beg, end, Match_engine::DFA) on the threads of the pool
+ */
+inline std::pair<const Char*, size_t> parallel_regex_search(const Regex& regex, const Char* beg, const Char* end,
+                                                            Thread_pool& pool)
+{
+    Parallel_dfa parallel_dfa(pool);
+    return parallel_dfa.search(regex, beg, end);
+}
+}  // namespace pcc
+
+#endif  // PARALLEL_DFA_H_PCC_
@@ -0,0 +1,154 @@
+#pragma once
+#ifndef PARALLEL_FIND_H_PCC_
+#define PARALLEL_FIND_H_PCC_
+
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+
+#include "match_scratch.h"
+#include "pcc_config.h"
+#include "pcc_template.h"
+#include "regex.h"
+#include "regex_iterator.h"
+#include "thread_pool.h"
+
+namespace pcc
+{
+/**
+ * @brief find_all over one large buffer, by chunks on the threads of a Thread_pool
+ *
+ *
+ * The buffer is split into chunks that end just after a delimiter (a record, for example a line),
+ * every chunk finds the matches that begin in it, searching from its begin, and they may end after it.
+ * The matches of the chunks are merged in order, and they are the same as find_all over the whole buffer:
+ * if a match of a chunk ends in the next chunk, the matches of the next chunk that begin before its end are dropped,
+ * and the next chunk is searched again from there until a match is the same as one of the next chunk.
+ * If the matches do not cross the delimiters, nothing is searched again.
+ *
+ * Every thread has its own Match_scratch, only the NFA of the regex is shared, so the regex is only read.
+ *
+ * For example, a regex: [0-9]+
+ *              a buffer: "a1\n22\nb333", chunks: "a1\n", "22\n", "b333"
+ *              the matches: { 1, 1 }, { 3, 2 }, { 7, 3 }
+ */
+class Parallel_finder
+{
+public:
+    /**
+     * @param min_chunk_size the chunks are not shorter than it, except the last one
+     */
+    Parallel_finder(Thread_pool& pool, Char delimiter = '\n', size_t min_chunk_size = DEFAULT_MIN_CHUNK_SIZE)
+        : pool(&pool), delimiter(delimiter), min_chunk_size(std::max<size_t>(min_chunk_size, 1)), scratches(pool.size())
+    {
+    }
+
+    Parallel_finder(const Parallel_finder&) = default;
+
+    Parallel_finder& operator=(const Parallel_finder&) = default;
+
+    ~Parallel_finder() = default;
+
+    /**
+     * @brief spans = all the leftmost-longest, not overlapping matches in [beg, end), in order
+     *
+     * @return the number of the matches
+     */
+    size_t find_all(const Regex& regex, const Char* beg, const Char* end, Vector<Match_span>& spans)
+    {
+        spans.clear();
+        split(beg, end);
+        const size_t chunk_num = bounds.size() - 1;
+        chunk_spans.resize(chunk_num);
+        pool->run(chunk_num, [&](size_t chunk, UInt thread_index) {
+            find_in_chunk(regex, beg, end, chunk, scratches[thread_index]);
+        });
+
+        // merge, the matches of a chunk are right if the last match before it ends at or before its begin
+        Match_scratch<Char>& scratch = scratches[0];
+        size_t last_end = 0;
+        for (size_t chunk = 0; chunk != chunk_num; ++chunk) {
+            const Vector<Match_span>& found = chunk_spans[chunk];
+            auto iter = found.begin();
+            size_t pos = last_end;
+            while (pos > bounds[chunk] && pos < bounds[chunk + 1]) {
+                auto result = Regex_match<void, void>::find(regex, beg + pos, end, bounds[chunk + 1] - pos, scratch);
+                if (result.first == result.second) {
+                    iter = found.end();
+                    break;
+                }
+                Match_span span{ size_t(result.first - beg), size_t(result.second - result.first) };
+                iter = std::lower_bound(found.begin(), found.end(), span.offset,
+                                        [](const Match_span& s, size_t offset) { return s.offset < offset; });
+                if (iter != found.end() && *iter == span)
+                    break;
+                spans.push_back(span);
+                pos = span.offset + span.length;
+            }
+            if (pos >= bounds[chunk + 1])
+                iter = found.end();
+            spans.insert(spans.end(), iter, found.end());
+            if (!spans.empty())
+                last_end = std::max(last_end, spans.back().offset + spans.back().length);
+        }
+        return spans.size();
+    }
+
+    static constexpr size_t DEFAULT_MIN_CHUNK_SIZE = 1 << 16;
+
+private:
+    /**
+     * @brief bounds = the offsets that the chunks begin at, and the size, about 4 chunks for each thread
+     */
+    void split(const Char* beg, const Char* end)
+    {
+        const size_t size = end - beg;
+        const size_t chunk_size = std::max(min_chunk_size, size / (size_t(pool->size()) * 4) + 1);
+        bounds.assign(1, 0);
+        while (bounds.back() + chunk_size < size) {
+            size_t from = bounds.back() + chunk_size;
+            const void* found = memchr(beg + from, delimiter, size - from);
+            if (found == nullptr)
+                break;
+            bounds.push_back(static_cast<const Char*>(found) - beg + 1);
+        }
+        if (bounds.back() != size || size == 0)
+            bounds.push_back(size);
+    }
+
+    void find_in_chunk(const Regex& regex, const Char* beg, const Char* end, size_t chunk, Match_scratch<Char>& scratch)
+    {
+        Vector<Match_span>& found = chunk_spans[chunk];
+        found.clear();
+        const size_t chunk_end = bounds[chunk + 1];
+        for (size_t pos = bounds[chunk]; pos < chunk_end;) {
+            auto result = Regex_match<void, void>::find(regex, beg + pos, end, chunk_end - pos, scratch);
+            if (result.first == result.second)
+                break;
+            found.push_back(Match_span{ size_t(result.first - beg), size_t(result.second - result.first) });
+            pos = result.second - beg;
+        }
+    }
+
+    Thread_pool* pool;
+    Char delimiter;
+    size_t min_chunk_size;
+    Vector<Match_scratch<Char>> scratches;    // scratches[thread_index]
+    Vector<size_t> bounds;
+    Vector<Vector<Match_span>> chunk_spans;
+};
+
+/**
+ * @brief find_all over [beg, end) on the threads of the pool, the matches are written into spans in order
+ *
+ * @return the number of the matches
+ */
+inline size_t parallel_find_all(const Regex& regex, const Char* beg, const Char* end, Thread_pool& pool,
+                                Vector<Match_span>& spans, Char delimiter = '\n')
+{
+    Parallel_finder finder(pool, delimiter);
+    return finder.find_all(regex, beg, end, spans);
+}
+}  // namespace pcc
+
+#endif  // PARALLEL_FIND_H_PCC_
@@ -0,0 +1,419 @@
+#pragma once
+#ifndef PIKE_VM_H_PCC_
+#define PIKE_VM_H_PCC_
+
+#include <algorithm>
+#include <cstddef>
+
+#include "byte_classes.h"
+#include "fa_status.h"
+#include "literal_prefilter.h"
+#include "match_scratch.h"
+#include "nfa_program.h"
+#include "pcc_config.h"
+#include "pcc_template.h"
+#include "thread_set.h"
+
+namespace pcc
+{
+using namespace fa_status;
+
+template <typename Char_t>
+struct NFA_node;
+
+template <typename Char_t>
+class Tagged_dfa;
+
+/**
+ * @brief the NFA of a regex with the capture groups, run by Pike's way to get the spans of the groups
+ *
+ *
+ * The group i of the regex is two tagged NFA status around it: the open status sets the slot 2 * i
+ * and the close status sets the slot 2 * i + 1 to the offset where a match reaches them.
+ * The slot 0 is the offset where the match begins.
+ *
+ * Like NFA_program, a step never walks the empty trans. The closure of a status is kept in the order
+ * that a backtracking matcher would try it (the first empty trans first, so the greedy repeats and the left
+ * alternative first), and every important status in it has the tags on the path to it.
+ * The threads of a step are kept in that order too, and a thread is only added the first time it is reached,
+ * so every thread has the slots of the most preferred path to it, and the time is O(n * m) for n chars and m status.
+ * The counted repeats are run with the counts of the NFA_program, the more X first,
+ * the threads are kept in a Thread_set, so the memory does not grow with the max of a repeat.
+ *
+ * The span of the match is the same as the other engines (leftmost-longest for find),
+ * and the groups are the ones of the most preferred path that makes that span.
+ * A group in a repeat has the span of its last run, a group that takes no part in the match is NO_OFFSET.
+ *
+ * All the memory of a run is in the Match_scratch, so nothing is allocated once the scratch is large enough.
+ *
+ * For example, a regex: (a|ab)(c|bcd)
+ *              find in "abcd": the match is "abcd", the group 1 is "a" and the group 2 is "bcd"
+ */
+template <typename Char_t>
+class Pike_vm
+{
+    template <typename _Char_t>
+    friend class Tagged_dfa;
+
+public:
+    Pike_vm() = default;
+
+    Pike_vm(const Pike_vm&) = default;
+
+    Pike_vm(Pike_vm&&) = default;
+
+    Pike_vm& operator=(const Pike_vm&) = default;
+
+    Pike_vm& operator=(Pike_vm&&) = default;
+
+    ~Pike_vm() = default;
+
+    /**
+     * @brief build the ordered closures with the tags from the nfa that the program is just frozen from
+     */
+    void build(Vector<NFA_node<Char_t>>& nfa, const NFA_program<Char_t>& program, UInt group_num)
+    {
+        clear();
+        groups = group_num;
+        slot_num = 2 * (group_num + 1);
+        status_num = program.size();
+        start = program.start_status();
+
+        range_offsets.assign(status_num + 1, 0);
+        accepts.assign(status_num, false);
+        for (Status_t s = 0; s != status_num; ++s) {
+            range_offsets[s] = ranges.size() / 2;
+            ranges.insert(ranges.end(), program.ranges_begin(s), program.ranges_end(s));
+            accepts[s] = program.is_accept(s);
+        }
+        range_offsets[status_num] = ranges.size() / 2;
+
+        Vector<bool> reached(status_num, false);
+        reached[start] = true;
+        for (UInt i = 1; i < ranges.size(); i += 2)
+            reached[ranges[i]] = true;
+        for (Status_t s = 0; s != status_num; ++s)
+            program.for_each_counter_target(s, [&reached](Status_t target) { reached[target] = true; });
+
+        Vector<Status_t> visited(status_num, 0);
+        closure_offsets.assign(status_num + 1, 0);
+        for (Status_t root = 0; root != status_num; ++root) {
+            closure_offsets[root] = closures.size();
+            if (reached[root])
+                collect_closure(nfa, program, root, visited);
+        }
+        closure_offsets[status_num] = closures.size();
+    }
+
+    void clear()
+    {
+        closure_offsets.clear();
+        closures.clear();
+        tags.clear();
+        range_offsets.clear();
+        ranges.clear();
+        accepts.clear();
+        groups = 0;
+        slot_num = 2;
+        status_num = 0;
+        start = 0;
+    }
+
+    bool empty() const { return status_num == 0; }
+
+    /**
+     * @return the number of the capture groups, the group 0 (the whole match) is not counted
+     */
+    UInt group_num() const { return groups; }
+
+    /**
+     * @brief the modes of run, the same matches as Basic_regex_match::match_for, search_for and find_for
+     */
+    static constexpr UInt MATCH = 0;
+    static constexpr UInt SEARCH = 1;
+    static constexpr UInt FIND = 2;
+
+    /**
+     * @brief run [beg, end) in the mode, groups[i] = the span of the group i of the match, groups[0] is the match,
+     *        all of them are NO_OFFSET if there is no match
+     *
+     * @param program the program frozen with the nfa of build, only its counters are used
+     * @return the offset of the char that all the threads die at, or the size of [beg, end)
+     */
+    template <typename Iter>
+    size_t run(const NFA_program<Char_t>& program, const Literal_prefilter<Char_t>& prefilter, Iter beg, Iter end,
+               UInt mode, Match_scratch<Char_t>& scratch, Vector<Match_span>& groups_out) const
+    {
+        static constexpr size_t NO_MATCH = Match_span::NO_OFFSET;
+        reserve(scratch);
+        Thread_set& cur_threads = scratch.cur_threads;
+        Thread_set& next_threads = scratch.next_threads;
+        Vector<size_t>& start_slots = scratch.match_slots;
+        groups_out.assign(groups + 1, Match_span{ NO_MATCH, 0 });
+        const size_t size = end - beg;
+        size_t match_beg = NO_MATCH, match_end = NO_MATCH, stop = size;
+        cur_threads.clear();
+        if (mode == FIND && !prefilter.may_match(beg, end))
+            return size;
+        size_t candidate = mode == FIND ? prefilter.find_prefix(beg, end, 0) : 0;
+
+        std::fill(start_slots.begin(), start_slots.begin() + slot_num, NO_MATCH);
+        for (size_t pos = 0;; ++pos) {
+            if (match_beg == NO_MATCH && (pos == 0 || mode == FIND)) {
+                if (mode == FIND && cur_threads.empty()) {
+                    if (candidate == size)
+                        break;
+                    pos = candidate;
+                }
+                if (pos == candidate) {
+                    start_slots[0] = pos;
+                    add_thread(program, cur_threads, scratch.cur_slots, start, 0, NFA_program<Char_t>::NO_COUNTER,
+                               start_slots.data(), 0, pos);
+                    candidate = mode == FIND ? prefilter.find_prefix(beg, end, pos + 1) : size;
+                }
+            }
+            if (cur_threads.empty()) {
+                stop = pos;
+                break;
+            }
+            if (pos == size)
+                break;
+
+            const Char_t c = beg[pos];
+            next_threads.clear();
+            for (UInt index = 0; index != cur_threads.size(); ++index) {
+                const size_t* slots = &scratch.cur_slots[size_t(index) * slot_num];
+                if (slots[0] > match_beg)
+                    break;
+                const Thread_set::Thread& thread = cur_threads[index];
+                for_each_trans(thread.status, c, [&](Status_t target) {
+                    add_thread(program, next_threads, scratch.next_slots, target, thread.count,
+                               NFA_program<Char_t>::NO_COUNTER, slots, 0, pos + 1);
+                });
+            }
+            cur_threads.swap(next_threads);
+            scratch.cur_slots.swap(scratch.next_slots);
+            if (cur_threads.empty() && (mode != FIND || match_beg != NO_MATCH)) {
+                stop = pos;
+                break;
+            }
+
+            // the threads are in the order of their begin, then of preference, so the first accept is the best one
+            if (mode == MATCH)
+                continue;
+            for (UInt index = 0; index != cur_threads.size(); ++index) {
+                const size_t* slots = &scratch.cur_slots[size_t(index) * slot_num];
+                if (slots[0] > match_beg)
+                    break;
+                if (accepts[cur_threads[index].status]) {
+                    match_beg = slots[0];
+                    match_end = pos + 1;
+                    std::copy(slots, slots + slot_num, scratch.match_slots.begin() + slot_num);
+                    break;
+                }
+            }
+        }
+
+        if (mode == MATCH && stop == size) {
+            for (UInt index = 0; index != cur_threads.size(); ++index) {
+                if (accepts[cur_threads[index].status]) {
+                    const size_t* slots = &scratch.cur_slots[size_t(index) * slot_num];
+                    match_beg = 0;
+                    match_end = size;
+                    std::copy(slots, slots + slot_num, scratch.match_slots.begin() + slot_num);
+                    break;
+                }
+            }
+        }
+        if (match_beg == NO_MATCH)
+            return stop;
+
+        const size_t* slots = &scratch.match_slots[slot_num];
+        groups_out[0] = Match_span{ match_beg, match_end - match_beg };
+        for (UInt group = 1; group <= groups; ++group) {
+            if (slots[2 * group] != NO_MATCH && slots[2 * group + 1] != NO_MATCH)
+                groups_out[group] = Match_span{ slots[2 * group], slots[2 * group + 1] - slots[2 * group] };
+        }
+        return stop;
+    }
+
+    /**
+     * @brief split the classes so that no char trans of the Pike VM can tell apart two chars in a class,
+     *        the same as NFA_program::refine_classes
+     */
+    void refine_classes(Byte_classes& classes) const
+    {
+        Status_t keys[CHAR_AMOUNT];
+        Vector<Status_t> targets;
+        for (Status_t s = 0; s != status_num; ++s) {
+            const UInt* range_beg = ranges.data() + 2 * range_offsets[s];
+            const UInt* range_end = ranges.data() + 2 * range_offsets[s + 1];
+            targets.clear();
+            for (auto range = range_beg; range != range_end; range += 2)
+                targets.push_back(NFA_program<Char_t>::range_target(range));
+            std::sort(targets.begin(), targets.end());
+            targets.erase(std::unique(targets.begin(), targets.end()), targets.end());
+
+            for (Status_t target : targets) {
+                std::fill(keys, keys + CHAR_AMOUNT, 0);
+                for (auto range = range_beg; range != range_end; range += 2) {
+                    if (NFA_program<Char_t>::range_target(range) != target)
+                        continue;
+                    for (UInt c = NFA_program<Char_t>::range_lo(range); c <= NFA_program<Char_t>::range_hi(range); ++c)
+                        keys[c] = 1;
+                }
+                classes.refine(keys);
+            }
+        }
+    }
+
+    /**
+     * @return the bytes of memory that the Pike VM uses
+     */
+    size_t memory_usage() const
+    {
+        return sizeof(*this) +
+               (closure_offsets.capacity() + tags.capacity() + range_offsets.capacity() + ranges.capacity()) *
+                   sizeof(UInt) +
+               closures.capacity() * sizeof(Closure_entry) + accepts.capacity() / 8;
+    }
+
+private:
+    /**
+     * @brief an important status in a closure, with the tags on the path to it: tags[tag_beg ... tag_end)
+     */
+    struct Closure_entry {
+        Status_t status;
+        UInt tag_beg;
+        UInt tag_end;
+    };
+
+    /**
+     * @brief walk the empty trans from the root in the order of preference, depth first,
+     *        a status reached again is not walked again, the first path to it is preferred,
+     *        a status whose chars go last (NFA_node::is_trans_last) is put after the status reached from it
+     */
+    void collect_closure(Vector<NFA_node<Char_t>>& nfa, const NFA_program<Char_t>& program, Status_t root,
+                         Vector<Status_t>& visited)
+    {
+        struct Frame {
+            Status_t status;
+            UInt next_trans;
+            bool tagged;
+        };
+        Vector<Frame> stack;
+        Vector<UInt> path;
+        auto add_entry = [&](Status_t s) {
+            if (accepts[s] || program.has_trans(s) || program.is_counter(s)) {
+                closures.push_back(Closure_entry{ s, UInt(tags.size()), UInt(tags.size() + path.size()) });
+                tags.insert(tags.end(), path.begin(), path.end());
+            }
+        };
+        auto enter = [&](Status_t s) {
+            visited[s] = root + 1;
+            const UInt tag = nfa[s].get_tag();
+            if (tag != NFA_node<Char_t>::NO_TAG)
+                path.push_back(tag);
+            if (!nfa[s].is_trans_last())
+                add_entry(s);
+            stack.push_back(Frame{ s, 0, tag != NFA_node<Char_t>::NO_TAG });
+        };
+
+        enter(root);
+        while (!stack.empty()) {
+            Frame& frame = stack.back();
+            // the empty trans of the counter status are taken by the counts when the VM runs
+            auto& empty_trans = nfa[frame.status].get_empty_trans();
+            if (program.is_counter(frame.status) || frame.next_trans == empty_trans.size()) {
+                if (nfa[frame.status].is_trans_last())
+                    add_entry(frame.status);
+                if (frame.tagged)
+                    path.pop_back();
+                stack.pop_back();
+                continue;
+            }
+            const Status_t target = empty_trans[frame.next_trans++];
+            if (visited[target] != root + 1)
+                enter(target);
+        }
+    }
+
+    void reserve(Match_scratch<Char_t>& scratch) const
+    {
+        scratch.cur_threads.reserve(status_num);
+        scratch.next_threads.reserve(status_num);
+        const size_t slot_size = size_t(status_num) * slot_num;
+        if (scratch.cur_slots.size() < slot_size) {
+            scratch.cur_slots.resize(slot_size);
+            scratch.next_slots.resize(slot_size);
+        }
+        // match_slots[0 ... slot_num) are the slots of a new thread, the slots of the match follow
+        if (scratch.match_slots.size() != 2 * slot_num)
+            scratch.match_slots.resize(2 * slot_num);
+    }
+
+    /**
+     * @brief the same as NFA_program::for_each_trans, with the ranges kept here,
+     *        so that the program may be rewritten by NFA_program::eliminate_empty_trans
+     */
+    template <typename Fn>
+    void for_each_trans(Status_t s, Char_t c, Fn fn) const
+    {
+        const UChar uc = UChar(c);
+        for (UInt range = range_offsets[s]; range != range_offsets[s + 1]; ++range) {
+            const UInt* r = &ranges[2 * range];
+            if (NFA_program<Char_t>::range_lo(r) > uc)
+                break;
+            if (uc <= NFA_program<Char_t>::range_hi(r))
+                fn(NFA_program<Char_t>::range_target(r));
+        }
+    }
+
+    /**
+     * @brief add the threads of the closure of the status with the count to the set in the order of preference,
+     *        a new thread has the slots from with the tags on the path to it set to pos,
+     *        all_slots[i * slot_num ... (i + 1) * slot_num) are the slots of the thread set[i]
+     *
+     *
+     * The slots of a counter thread are the slots of the threads it takes, it does nothing else in a step.
+     * all_slots may grow while the threads are added, so a counter thread passes its index as from_index
+     * (and from as nullptr) to the threads it takes.
+     */
+    void add_thread(const NFA_program<Char_t>& program, Thread_set& set, Vector<size_t>& all_slots, Status_t s,
+                    UInt count, UInt no_loop, const size_t* from, UInt from_index, size_t pos) const
+    {
+        for (UInt i = closure_offsets[s]; i != closure_offsets[s + 1]; ++i) {
+            const Closure_entry& entry = closures[i];
+            if (!set.insert(entry.status, count))
+                continue;
+            const UInt index = set.size() - 1;
+            Match_scratch<Char_t>::grow(all_slots, size_t(index + 1) * slot_num);
+            size_t* slots = all_slots.data() + size_t(index) * slot_num;
+            const size_t* source = from != nullptr ? from : all_slots.data() + size_t(from_index) * slot_num;
+            std::copy(source, source + slot_num, slots);
+            for (UInt tag = entry.tag_beg; tag != entry.tag_end; ++tag)
+                slots[tags[tag]] = pos;
+            if (program.is_counter(entry.status)) {
+                program.for_each_counter_step(entry.status, count, no_loop,
+                                              [&](Status_t target, UInt target_count, UInt target_no_loop) {
+                                                  add_thread(program, set, all_slots, target, target_count,
+                                                             target_no_loop, nullptr, index, pos);
+                                              });
+            }
+        }
+    }
+
+    Vector<UInt> closure_offsets;    // the closure of s is closures[closure_offsets[s] ... closure_offsets[s + 1])
+    Vector<Closure_entry> closures;
+    Vector<UInt> tags;
+    Vector<UInt> range_offsets;      // the same char ranges as the program when it is frozen
+    Vector<UInt> ranges;
+    Vector<bool> accepts;
+    UInt groups = 0;
+    UInt slot_num = 2;
+    Status_t status_num = 0;
+    Status_t start = 0;
+};
+}  // namespace pcc
+
+#endif  // PIKE_VM_H_PCC_
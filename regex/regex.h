@@ -3,16 +3,31 @@
 #define REGEX_H_PCC_
 
 #include <cstdio>
+#include <algorithm>
+#include <atomic>
 #include <cstring>
 #include <exception>
 #include <functional>
+#include <istream>
+#include <stdexcept>
 #include <string>
+#include <string_view>
 #include <utility>
 
+#include "bit_parallel_nfa.h"
+#include "byte_classes.h"
+#include "dense_dfa.h"
 #include "fa_status.h"
+#include "find_dfa.h"
+#include "lazy_dfa.h"
+#include "literal_prefilter.h"
+#include "match_scratch.h"
+#include "nfa_program.h"
 #include "pcc_config.h"
 #include "pcc_template.h"
+#include "pike_vm.h"
 #include "regex_lexer.h"
+#include "tagged_dfa.h"
 #ifdef DEBUG
 #include "test_tools.h"
 #endif
@@ -133,6 +148,26 @@ struct NFA_node {
 
     void add_empty_trans(Status_t s) { empty_trans.push_back(s); }
 
+    /**
+     * @brief add the empty trans before the others, a match prefers it to them
+     */
+    void add_first_empty_trans(Status_t s) { empty_trans.insert(empty_trans.begin(), s); }
+
+    /**
+     * @brief the capture slot that is set to the offset where a match reaches the node, see Pike_vm
+     */
+    void set_tag(UInt t) { tag = t; }
+
+    UInt get_tag() const { return tag; }
+
+    /**
+     * @brief the chars of the node are tried after its empty trans by the Pike VM,
+     *        like the end of X+ that is followed by a char: X again is tried before the char
+     */
+    void set_trans_last() { trans_last = true; }
+
+    bool is_trans_last() const { return trans_last; }
+
     bool has_empty_trans() const { return !empty_trans.empty(); }
 
     bool has_trans() const { return !trans.empty(); }
@@ -181,6 +216,8 @@ struct NFA_node {
     static constexpr UInt ALL_ALPHA_NODE = 1;
     static constexpr UInt XOR_ALPHA_NODE = 2;
 
+    static constexpr UInt NO_TAG = UInt(-1);
+
 private:
     /**
      * @brief all the trans of the node of the nfa
@@ -201,10 +238,22 @@ private:
      * so we use small_vector to reduce the memory usage and avoid cache miss
      */
     UInt node_type = COMMON_NODE;
+    UInt tag = NO_TAG;
+    bool trans_last = false;
     SmallVec empty_trans;
     Hash_map<Char_t, Status_t> trans;
 };
 
+/**
+ * @return an id that is never returned again, a Match_scratch keeps the id of the regex whose lazy DFA it caches,
+ *         so a regex that is changed (or another regex) gets an id that the scratch does not know
+ */
+inline size_t next_lazy_dfa_id()
+{
+    static std::atomic<size_t> last_id{ 0 };
+    return last_id.fetch_add(1, std::memory_order_relaxed) + 1;
+}
+
 /**
  * @brief the template of the Regex
  *
@@ -238,6 +287,12 @@ public:
             throw std::logic_error("Wrong regex");
     }
 
+    Basic_regex(std::basic_string_view<Char_t> regex) : Basic_regex()
+    {
+        if (!regenetare_regex(regex))
+            throw std::logic_error("Wrong regex");
+    }
+
     Basic_regex& operator=(const Basic_regex& other) = default;
 
     Basic_regex& operator=(Basic_regex&& other) = default;
@@ -247,37 +302,174 @@ public:
     template <typename Stream>
     bool regenetare_regex(Stream& stream)
     {
-        clear();
-        Vector<NFA_node_set> cache_stack;
-        if (!generate_nfa(stream, cache_stack)) {
-            clear();
-            return false;
-        }
-        assert(cache_stack.size() == 1);
-        start_status = cache_stack.back().elems.first;
-        accept_state.push_back(cache_stack.back().elems.second);
-
-        return true;
+        // every compilation has its own lexer buffer, so regex can be compiled on many threads at the same time
+        Char_t lexer_buff_memory[LEXER_BUFF_SIZE];
+        Regex_lexer<Char_t, Stream> lexer(lexer_buff_memory, lexer_buff_memory + LEXER_BUFF_SIZE, stream);
+        return generate_regex(lexer);
     }
 
-    bool regenetare_regex(const Char_t* regex)
+    /**
+     * @brief the regex is read from the view directly, no stream is made and no char is copied
+     */
+    bool regenetare_regex(std::basic_string_view<Char_t> regex)
     {
-        std::stringstream regex_stream(regex);
-        return regenetare_regex(regex_stream);
+        Regex_lexer<Char_t, std::basic_string_view<Char_t>> lexer(regex);
+        return generate_regex(lexer);
     }
 
+    bool regenetare_regex(const Char_t* regex) { return regenetare_regex(std::basic_string_view<Char_t>(regex)); }
+
     void clear()
     {
         nfa.clear();
+        counters.clear();
         accept_state.clear();
+        program.clear();
+        bit_parallel.clear();
+        byte_classes.clear();
+        lazy_dfa_id = next_lazy_dfa_id();
+        dense_dfa.clear();
+        find_dfa.clear();
+        prefilter.clear();
+        pike_vm.clear();
+        tagged_dfa.clear();
+        group_total = 0;
+        group_stack.clear();
+    }
+
+    /**
+     * @brief build the complete, minimized DFA of the regex for the engine Match_engine::DFA,
+     *        and the forward and reverse DFAs that find runs (see Find_dfa)
+     *
+     * @return false if the DFA needs more than state_limit status (a counted repeat needs a DFA status
+     *         for every count that it reaches), then the engine Match_engine::DFA falls back to the NFA,
+     *         find falls back to the NFA on its own if has_find_dfa() is false
+     */
+    bool compile_dfa(UInt state_limit = Dense_dfa<Char_t>::DEFAULT_STATE_LIMIT)
+    {
+        find_dfa.build(program, byte_classes, state_limit);
+        return dense_dfa.build(program, byte_classes, state_limit);
+    }
+
+    bool has_dfa() const { return !dense_dfa.empty(); }
+
+    /**
+     * @return the DFA built by compile_dfa, it is empty if has_dfa() is false
+     */
+    const Dense_dfa<Char_t>& get_dfa() const { return dense_dfa; }
+
+    bool has_find_dfa() const { return !find_dfa.empty(); }
+
+    /**
+     * @return the DFAs of find built by compile_dfa, they are empty if has_find_dfa() is false
+     */
+    const Find_dfa<Char_t>& get_find_dfa() const { return find_dfa; }
+
+    /**
+     * @brief build the tagged DFA of the capture groups, then the groups of a match are found by it
+     *        instead of the Pike VM
+     *
+     * @return false if the regex has no groups, has counted repeats or the DFA needs more than state_limit status,
+     *         then the groups are still found by the Pike VM
+     */
+    bool compile_tagged_dfa(UInt state_limit = Tagged_dfa<Char_t>::DEFAULT_STATE_LIMIT)
+    {
+        if (group_total == 0)
+            return false;
+        return tagged_dfa.build(pike_vm, program, state_limit);
+    }
+
+    bool has_tagged_dfa() const { return !tagged_dfa.empty(); }
+
+    /**
+     * @return the DFA built by compile_tagged_dfa, it is empty if has_tagged_dfa() is false
+     */
+    const Tagged_dfa<Char_t>& get_tagged_dfa() const { return tagged_dfa; }
+
+    /**
+     * @brief rewrite the NFA of the regex so that it has no empty trans at all,
+     *        then the NFA engine only follows the char trans, the lazy DFA caches of the regex are flushed
+     */
+    void eliminate_empty_trans()
+    {
+        program.eliminate_empty_trans();
+        bit_parallel.build(program);
+        generate_byte_classes();
+        lazy_dfa_id = next_lazy_dfa_id();
+        prefilter.build(program);
+    }
+
+    /**
+     * @return the frozen NFA that all the engines run on
+     */
+    const NFA_program<Char_t>& get_program() const { return program; }
+
+    bool has_bit_parallel() const { return !bit_parallel.empty(); }
+
+    /**
+     * @return the bit-parallel NFA that the NFA engine runs if has_bit_parallel() is true
+     */
+    const Bit_parallel_nfa<Char_t>& get_bit_parallel() const { return bit_parallel; }
+
+    /**
+     * @return the literals that every match contains, find skips to the places where they occur
+     */
+    const Literal_prefilter<Char_t>& get_prefilter() const { return prefilter; }
+
+    /**
+     * @return the number of the capture groups (the brackets) in the regex
+     */
+    UInt group_num() const { return group_total; }
+
+    /**
+     * @return the bytes of memory that the compiled regex uses, the lazy DFA caches live in the Match_scratch
+     */
+    size_t memory_usage() const
+    {
+        return sizeof(*this) + program.memory_usage() + bit_parallel.memory_usage() + prefilter.memory_usage() +
+               (has_dfa() ? dense_dfa.memory_usage() : 0) + (has_find_dfa() ? find_dfa.memory_usage() : 0) +
+               (group_total != 0 ? pike_vm.memory_usage() : 0) + (has_tagged_dfa() ? tagged_dfa.memory_usage() : 0);
+    }
+
+    /**
+     * @brief set the max number of DFA status cached by the lazy DFA engine,
+     *        the caches of the regex in every Match_scratch are flushed the next time they are used
+     */
+    void set_lazy_dfa_cache_limit(UInt limit)
+    {
+        lazy_dfa_cache_limit = limit;
+        lazy_dfa_id = next_lazy_dfa_id();
     }
 
 private:
-    template <typename Stream>
-    bool generate_nfa(Stream& stream, Vector<NFA_node_set>& cache_stack)
+    template <typename Lexer>
+    bool generate_regex(Lexer& lexer)
+    {
+        clear();
+        Vector<NFA_node_set> cache_stack;
+        if (!generate_nfa(lexer, cache_stack)) {
+            clear();
+            return false;
+        }
+        assert(cache_stack.size() == 1);
+        if (cache_stack.back().node_type == NFA_node_set::SINGEL_CHAR) {
+            Status_t now_status = nfa.size();
+            nfa.resize(nfa.size() + 2);
+            nfa[now_status].add_trans(status_to_char(cache_stack.back().elems.first), now_status + 1);
+            cache_stack.back().elems.first = now_status;
+            cache_stack.back().elems.second = now_status + 1;
+        }
+        start_status = cache_stack.back().elems.first;
+        accept_state.push_back(cache_stack.back().elems.second);
+        freeze();
+
+        return true;
+    }
+
+    template <typename Lexer>
+    bool generate_nfa(Lexer& lexer, Vector<NFA_node_set>& cache_stack)
     {
         Vector<Status_t> status;
-        Regex_lexer<Char_t, Stream> lexer(lexer_buff_memory, lexer_buff_memory + LEXER_BUFF_SIZE, stream);
 
         status.push_back(pred_table_begin_status());
         Status_t token = lexer.next_token();
@@ -307,12 +499,38 @@ private:
         return token == SIGN_DOLLER;
     }
 
+    /**
+     * @brief turn the nfa into the program that the engines run on, then release the nfa
+     */
+    void freeze()
+    {
+        program.freeze(nfa, start_status, accept_state.back(), counters);
+        if (group_total != 0)
+            pike_vm.build(nfa, program, group_total);
+        Vector<NFA_node<Char_t>>().swap(nfa);
+        Vector<NFA_counter>().swap(counters);
+        bit_parallel.build(program);
+        generate_byte_classes();
+        lazy_dfa_id = next_lazy_dfa_id();
+        prefilter.build(program);
+    }
+
+    /**
+     * @brief split the chars into classes that no transformation of the program can tell apart
+     */
+    void generate_byte_classes()
+    {
+        byte_classes.clear();
+        program.refine_classes(byte_classes);
+    }
+
     static bool product_fail(const Vector<Status_t>* vec) { return vec == &Production_FAILURE; }
 
     static bool lex_analy_fail(Status_t status) { return status == SIGN_FAILURE; }
 
+    template <typename Lexer>
     void execute_action(Status_t act_status, Vector<NFA_node_set>& stack, Status_t& token,
-                        Regex_lexer<Char_t, std::stringstream>& lexer)
+                        Lexer& lexer)
     {
         switch (act_status) {
             case ACTION_UNION:
@@ -342,6 +560,12 @@ private:
             case ACTION_RANGE:
                 act_range(stack, token, lexer);
                 return;
+            case ACTION_GROUP_BEGIN:
+                act_group_begin();
+                return;
+            case ACTION_GROUP_END:
+                act_group_end(stack);
+                return;
         }
         assert(false);
     }
@@ -393,6 +617,7 @@ private:
                     stack.back().elems.second = now_status;
                 } else {
                     nfa[node_1->elems.second].add_trans(status_to_char(node_2->elems.first), nfa.size() - 1);
+                    nfa[node_1->elems.second].set_trans_last();
                     stack.pop_back();
                     stack.back().node_type = NFA_node_set::MID_SEQUENCE;
                     stack.back().elems.second = nfa.size() - 1;
@@ -404,9 +629,12 @@ private:
             case NFA_node_set::COMPSEQ_N_COMPSEQ:
                 nfa[node_1->elems.second].add_empty_trans(node_2->elems.first);
                 mid_iter = stack.end() - 2;
+                // the begin status is the one of node_1 and the end status is the one of node_2
                 if (mid_iter->node_type == NFA_node_set::COMPLETE_SEQ &&
                     (mid_iter + 1)->node_type == NFA_node_set::COMPLETE_SEQ)
                     mid_iter->node_type = NFA_node_set::COMPLETE_SEQ;
+                else
+                    mid_iter->node_type = NFA_node_set::MID_SEQUENCE;
                 now_status = stack.back().elems.second;
                 stack.pop_back();
                 stack.back().elems.second = now_status;
@@ -438,9 +666,9 @@ private:
 
             case NFA_node_set::CHAR_N_MIDSEQ:
                 if (node_1->node_type == NFA_node_set::SINGEL_CHAR)
-                    or_char_midseq(node_1, node_2, stack);
+                    or_char_midseq(node_1, node_2, stack, false);
                 else
-                    or_char_midseq(node_2, node_1, stack);
+                    or_char_midseq(node_2, node_1, stack, group_total != 0);
                 stack.pop_back();
                 stack.back().node_type = NFA_node_set::MID_SEQUENCE;
                 stack.back().elems.first = now_status;
@@ -449,10 +677,10 @@ private:
 
             case NFA_node_set::CHAR_N_COMPSEQ:
                 if (node_1->node_type == NFA_node_set::SINGEL_CHAR) {
-                    or_char_compseq(node_1, node_2, stack);
+                    or_char_compseq(node_1, node_2, stack, false);
                     stack.erase(stack.end() - 2);
                 } else {
-                    or_char_compseq(node_2, node_1, stack);
+                    or_char_compseq(node_2, node_1, stack, group_total != 0);
                     stack.pop_back();
                 }
                 stack.back().node_type = NFA_node_set::MID_SEQUENCE;
@@ -473,7 +701,9 @@ private:
 
             case NFA_node_set::MIDSEQ_N_COMPSEQ:
                 if (node_1->node_type == NFA_node_set::MID_SEQUENCE) {
-                    or_midseq_compseq(node_1, node_2, stack);
+                    // the left one is tried first by the Pike VM, so its empty trans goes before the others
+                    nfa[node_2->elems.first].add_first_empty_trans(node_1->elems.first);
+                    nfa[node_1->elems.second].add_empty_trans(node_2->elems.second);
                     stack.erase(stack.end() - 2);
                 } else {
                     or_midseq_compseq(node_2, node_1, stack);
@@ -492,19 +722,37 @@ private:
         debug_show(stack, "|, or end");
     }
 
-    void or_char_midseq(NFA_node_set* node1, NFA_node_set* node2, Vector<NFA_node_set>& stack)
+    /**
+     * @brief the char of the begin status is tried before its empty trans by the Pike VM,
+     *        so if the char is the right one and the regex has groups (char_last), the char gets its own status
+     *        after the empty trans to the other one
+     */
+    void or_char_midseq(NFA_node_set* node1, NFA_node_set* node2, Vector<NFA_node_set>& stack, bool char_last)
     {
         Status_t now_status = nfa.size();
-        nfa.resize(nfa.size() + 2);
-        auto iter = nfa.end() - 2;
-        iter->add_trans(status_to_char(node1->elems.first), now_status + 1);
-        iter->add_empty_trans(node2->elems.first);
+        nfa.resize(nfa.size() + (char_last ? 3 : 2));
+        auto iter = nfa.begin() + now_status;
+        if (char_last) {
+            iter->add_empty_trans(node2->elems.first);
+            iter->add_empty_trans(now_status + 2);
+            nfa[now_status + 2].add_trans(status_to_char(node1->elems.first), now_status + 1);
+        } else {
+            iter->add_trans(status_to_char(node1->elems.first), now_status + 1);
+            iter->add_empty_trans(node2->elems.first);
+        }
         nfa[node2->elems.second].add_empty_trans(now_status + 1);
     }
 
-    void or_char_compseq(NFA_node_set* node1, NFA_node_set* node2, Vector<NFA_node_set>& stack)
+    void or_char_compseq(NFA_node_set* node1, NFA_node_set* node2, Vector<NFA_node_set>& stack, bool char_last)
     {
-        nfa[node2->elems.first].add_trans(status_to_char(node1->elems.first), node2->elems.second);
+        if (char_last) {
+            Status_t now_status = nfa.size();
+            nfa.resize(nfa.size() + 1);
+            nfa[now_status].add_trans(status_to_char(node1->elems.first), node2->elems.second);
+            nfa[node2->elems.first].add_empty_trans(now_status);
+        } else {
+            nfa[node2->elems.first].add_trans(status_to_char(node1->elems.first), node2->elems.second);
+        }
     }
 
     void or_midseq_compseq(NFA_node_set* node1, NFA_node_set* node2, Vector<NFA_node_set>& stack)
@@ -513,7 +761,8 @@ private:
         nfa[node1->elems.second].add_empty_trans(node2->elems.second);
     }
 
-    void act_alpha(Vector<NFA_node_set>& stack, Status_t& token, Regex_lexer<Char_t, std::stringstream>& lexer)
+    template <typename Lexer>
+    void act_alpha(Vector<NFA_node_set>& stack, Status_t& token, Lexer& lexer)
     {
         stack.push_back(NFA_node_set(NFA_node_set::SINGEL_CHAR, token, 0));
         token = lexer.next_token();
@@ -521,10 +770,59 @@ private:
         debug_show(stack, "push alpha end");
     }
 
+    /**
+     * @brief the groups are numbered by their left brackets from 1
+     */
+    void act_group_begin() { group_stack.push_back(++group_total); }
+
+    /**
+     * @brief (X), X is put between two tagged status, which are put between two new status:
+     *        begin -> open -> X -> close -> end,
+     *        the open status has the tag 2 * group and the close status has the tag 2 * group + 1, see Pike_vm
+     *
+     *
+     * The tagged status are not the begin and the end of the group, so the empty trans and the chars
+     * that other sub regex add to the begin or the end of the group do not pass the tags.
+     * The group is a COMPLETE_SEQ.
+     */
+    void act_group_end(Vector<NFA_node_set>& stack)
+    {
+        const UInt group = group_stack.back();
+        group_stack.pop_back();
+        NFA_node_set& sub = stack.back();
+        if (sub.node_type == NFA_node_set::SINGEL_CHAR) {
+            Status_t now_status = nfa.size();
+            nfa.resize(nfa.size() + 2);
+            nfa[now_status].add_trans(status_to_char(sub.elems.first), now_status + 1);
+            sub.elems.first = now_status;
+            sub.elems.second = now_status + 1;
+        }
+
+        const Status_t beg = nfa.size(), open = beg + 1, close = beg + 2, end = beg + 3;
+        nfa.resize(nfa.size() + 4);
+        nfa[beg].add_empty_trans(open);
+        nfa[open].set_tag(2 * group);
+        nfa[open].add_empty_trans(sub.elems.first);
+        nfa[sub.elems.second].add_empty_trans(close);
+        nfa[close].set_tag(2 * group + 1);
+        nfa[close].add_empty_trans(end);
+        sub.node_type = NFA_node_set::COMPLETE_SEQ;
+        sub.elems.first = beg;
+        sub.elems.second = end;
+
+        debug_show(stack, "(), group end");
+    }
+
     static constexpr UInt REPEAT_REP = 0;
     static constexpr UInt REPEAT_ONE_OR = 1;
     static constexpr UInt REPEAT_ZERO_ONE = 2;
 
+    /**
+     * @brief X{n,m} is copied if its copies have at most so many status, otherwise it is counted
+     */
+    static constexpr UInt REPEAT_EXPAND_LIMIT = 256;
+    static constexpr UInt MAX_REPEAT_COUNT = 65535;
+
     void act_rep(Vector<NFA_node_set>& stack)
     {
         repeat_action_aux<REPEAT_REP>(stack);
@@ -573,7 +871,8 @@ private:
         stack.back().node_type = NFA_node_set::MID_SEQUENCE;
     }
 
-    void act_any_alpha(Vector<NFA_node_set>& stack, Status_t& token, Regex_lexer<Char_t, std::stringstream>& lexer)
+    template <typename Lexer>
+    void act_any_alpha(Vector<NFA_node_set>& stack, Status_t& token, Lexer& lexer)
     {
         assert(token == SIGN_DOT);
         Status_t now_status = nfa.size();
@@ -586,7 +885,20 @@ private:
         debug_show(stack, ". any_alpha end");
     }
 
-    void act_rep_for(Vector<NFA_node_set>& stack, Status_t& token, Regex_lexer<Char_t, std::stringstream>& lexer)
+    /**
+     * @brief X{n,m}, X{n,} and X{,m}
+     *
+     *
+     * If the copies of X are small (fragment size * copies <= REPEAT_EXPAND_LIMIT), X is copied:
+     *     X{2,3}: -> X -> X -> X ->      (the end of the second and the third X trans to the end)
+     *     X{2,} : -> X -> X ->           (the end of the second X also trans to its begin)
+     * Otherwise X is kept once and counted by two counter status, see NFA_counter,
+     * so the NFA does not grow with the numbers. A counted X that has another counted repeat in it is copied,
+     * the counter status of the inner repeat are copied with it.
+     * The begin status and the end status of X{n,m} are new status, so X{n,m} is a COMPLETE_SEQ.
+     */
+    template <typename Lexer>
+    void act_rep_for(Vector<NFA_node_set>& stack, Status_t& token, Lexer& lexer)
     {
         assert(token == SIGN_LEFT_BRACE);
         Status_t nums[2] = { 0, 0 };
@@ -594,81 +906,52 @@ private:
         if (token == SIGN_FAILURE)
             return;
         token = lexer.next_token();
-        if (nums[0] == 0 && nums[1] == 1) {
+        const UInt min = nums[0];
+        const UInt max = meet_2nd ? nums[1] : NFA_counter::NO_LIMIT;
+        if (min == 0 && max == 1) {
             act_zero_one(stack);
             return;
         }
-
-        if (!meet_2nd) {
-            if (nums[0] == 0) {
-                act_rep(stack);
-                return;
-            } else if (nums[0] == 1) {
-                act_one_or(stack);
-                return;
-            }
-            nums[1] = nums[0];
+        if (max == NFA_counter::NO_LIMIT && min == 0) {
+            act_rep(stack);
+            return;
         }
-
-        Status_t beg = nfa.size();
-        auto& rep_range = stack.back();
-        Char_t c;
-        switch (rep_range.node_type) {
-            case NFA_node_set::SINGEL_CHAR:
-                c = status_to_char(rep_range.elems.first);
-                nfa.resize(nfa.size() + nums[1] + 1);
-                for (Status_t i = 0; i != nums[1]; ++i)
-                    nfa[beg + i].add_trans(c, beg + i + 1);
-                if (meet_2nd) {
-                    for (Status_t i = beg + nums[0]; i != nfa.size() - 1; ++i)
-                        nfa[i].add_empty_trans(nfa.size() - 1);
-                } else {
-                    nfa[beg + nums[0]].add_empty_trans(beg + nums[0] - 1);
-                }
-                rep_range.node_type = NFA_node_set::MID_SEQUENCE;
-                rep_range.elems.first = beg;
-                rep_range.elems.second = nfa.size() - 1;
-                debug_show(stack, "{,}alpha");
-                return;
-            case NFA_node_set::MID_SEQUENCE:
-                nfa.resize(nfa.size() + 2);
-                nfa[beg].add_empty_trans(rep_range.elems.first);
-                nfa[rep_range.elems.second].add_empty_trans(beg + 1);
-                rep_range.elems.first = beg;
-                rep_range.elems.second = beg + 1;
+        if (max == NFA_counter::NO_LIMIT && min == 1) {
+            act_one_or(stack);
+            return;
         }
+        if (min == 1 && max == 1)
+            return;
 
-        debug_show(stack, "{,} mid_handle");
-
-        const Status_t new_status_beg = nfa.size();
-        const Status_t expand_times = nums[1] - 2;
-        Status_t new_end_ind;
-        const Status_t new_status_size = generate_new_status(rep_range, new_end_ind);
-        debug_show(stack, "{,} new_status");
-
-        expand_other(new_status_beg, new_status_size, expand_times, rep_range);
-        debug_show(stack, "{,} expand_other");
-
-        link_all_status(new_status_beg, new_status_size, new_end_ind, rep_range);
-
-        if (nums[0] != nums[1]) {
-            if (meet_2nd) {
-                generate_rep_for_trans(new_status_beg, new_status_size, new_end_ind, nums, rep_range);
-                rep_range.node_type == NFA_node_set::COMPLETE_SEQ;
-            } else {
-                Status_t final_beg = new_status_beg + new_status_size * (nums[1] - 2);
-                Status_t all_status_end = final_beg + new_end_ind;
-                nfa[all_status_end].add_empty_trans(final_beg);
-                rep_range.node_type == NFA_node_set::MID_SEQUENCE;
-            }
+        NFA_node_set& rep_range = stack.back();
+        if (rep_range.node_type == NFA_node_set::SINGEL_CHAR) {
+            Status_t now_status = nfa.size();
+            nfa.resize(nfa.size() + 2);
+            nfa[now_status].add_trans(status_to_char(rep_range.elems.first), now_status + 1);
+            rep_range.elems.first = now_status;
+            rep_range.elems.second = now_status + 1;
         }
 
-        rep_range.elems.second = new_status_beg + new_end_ind + expand_times * new_status_size;
+        Vector<Status_t> fragment;
+        Hash_map<Status_t, Status_t> fragment_index;
+        const bool has_counter = collect_fragment(rep_range, fragment, fragment_index);
+        const UInt copies = max == NFA_counter::NO_LIMIT ? min : max;
+        if (has_counter || size_t(fragment.size()) * copies <= REPEAT_EXPAND_LIMIT)
+            expand_repeat(rep_range, fragment, fragment_index, min, max);
+        else
+            count_repeat(rep_range, min, max);
+        rep_range.node_type = NFA_node_set::COMPLETE_SEQ;
 
         debug_show(stack, "{,} rep_for end");
     }
 
-    int parse_nums(Status_t nums[2], Status_t& token, Regex_lexer<Char_t, std::stringstream>& lexer)
+    /**
+     * @brief nums = { n, m } of {n,m}, {n,} or {,m}
+     *
+     * @return 1 if m is given
+     */
+    template <typename Lexer>
+    int parse_nums(Status_t nums[2], Status_t& token, Lexer& lexer)
     {
         int meet_2nd;
         for (int i = 0; i != 2; ++i) {
@@ -683,155 +966,132 @@ private:
                 }
                 meet_2nd = 1;
                 nums[i] = nums[i] * 10 + char_to_digit(status_to_char(token));
+                if (nums[i] > MAX_REPEAT_COUNT) {
+                    token = SIGN_FAILURE;
+                    return 0;
+                }
             }
         }
-        if (meet_2nd && nums[0] > nums[1] && (nums[0] != 0 && nums[1] != 0))
+        if (meet_2nd && nums[0] > nums[1])
             token = SIGN_FAILURE;
 
         return meet_2nd;
     }
 
-    Status_t generate_new_status(NFA_node_set rep_range, Status_t& new_end_ind)
-    {
-        static constexpr UInt array_map_size = 64;
-        if (nfa.size() > array_map_size)
-            return generate_new_status_large(rep_range, new_end_ind);
-
-        Vector<Status_t> added_old_status;
-        Status_t old_to_new_status[array_map_size];
-        memset(old_to_new_status, (unsigned char)(-1), sizeof(old_to_new_status));
-        const Status_t new_status_beg = nfa.size();
-        Status_t new_status_ind = 0;
-        added_old_status.push_back(rep_range.elems.first);
-        nfa.resize(nfa.size() + 1);
-        nfa.back().set_node_type(nfa[rep_range.elems.first].get_node_type());
-
-        while (new_status_ind != added_old_status.size()) {
-            Status_t now_copy_status = added_old_status[new_status_ind];
-            Status_t now_new_status = new_status_beg + new_status_ind;
-
-            int size = nfa[now_copy_status].get_empty_trans().size();
-            for (int i = 0; i != size; ++i) {
-                Status_t emp_trans_to_status = nfa[now_copy_status].get_empty_trans()[i];
-                if (old_to_new_status[emp_trans_to_status] == UInt(-1)) {
-                    old_to_new_status[emp_trans_to_status] = nfa.size();
-                    nfa.resize(nfa.size() + 1);
-                    nfa.back().set_node_type(nfa[emp_trans_to_status].get_node_type());
-                    added_old_status.push_back(emp_trans_to_status);
-                }
-                nfa[now_new_status].add_empty_trans(old_to_new_status[emp_trans_to_status]);
-            }
-
-            for (auto kv : nfa[now_copy_status].get_trans()) {
-                if (old_to_new_status[kv.second] == UInt(-1)) {
-                    old_to_new_status[kv.second] = nfa.size();
-                    nfa.resize(nfa.size() + 1);
-                    nfa.back().set_node_type(nfa[kv.second].get_node_type());
-                    added_old_status.push_back(kv.second);
-                }
-                nfa[now_new_status].add_trans(kv.first, old_to_new_status[kv.second]);
-            }
-            ++new_status_ind;
-        }
-        new_end_ind = old_to_new_status[rep_range.elems.second] - new_status_beg;
-
-        return new_status_ind;
-    }
-
-    Status_t generate_new_status_large(NFA_node_set rep_range, Status_t& new_end_ind)
+    /**
+     * @brief collect the status of the sub regex from its begin status, in the order they are reached
+     *
+     * @return true if the sub regex has a counted repeat in it
+     */
+    bool collect_fragment(const NFA_node_set& rep_range, Vector<Status_t>& fragment,
+                          Hash_map<Status_t, Status_t>& fragment_index)
     {
-        Vector<Status_t> added_old_status;
-        Hash_map<Status_t, Status_t> old_to_new_status;
-        const Status_t new_status_beg = nfa.size();
-        Status_t new_status_ind = 0;
-        added_old_status.push_back(rep_range.elems.first);
-        nfa.resize(nfa.size() + 1);
-        nfa.back().set_node_type(nfa[rep_range.elems.first].get_node_type());
-
-        while (new_status_ind != added_old_status.size()) {
-            Status_t now_copy_status = added_old_status[new_status_ind];
-            Status_t now_new_status = new_status_beg + new_status_ind;
-
-            int size = nfa[now_copy_status].get_empty_trans().size();
-            for (int i = 0; i != size; ++i) {
-                Status_t emp_trans_to_status = nfa[now_copy_status].get_empty_trans()[i];
-                auto iter = old_to_new_status.find(emp_trans_to_status);
-
-                if (iter == old_to_new_status.end()) {
-                    iter = old_to_new_status.insert({ emp_trans_to_status, nfa.size() }).first;
-                    nfa.resize(nfa.size() + 1);
-                    nfa.back().set_node_type(nfa[emp_trans_to_status].get_node_type());
-                    added_old_status.push_back(emp_trans_to_status);
-                }
-                nfa[now_new_status].add_empty_trans(iter->second);
-            }
-
-            for (auto kv : nfa[now_copy_status].get_trans()) {
-                auto iter = old_to_new_status.find(kv.second);
-
-                if (iter == old_to_new_status.end()) {
-                    iter = old_to_new_status.insert({ kv.second, nfa.size() }).first;
-                    nfa.resize(nfa.size() + 1);
-                    nfa.back().set_node_type(nfa[kv.second].get_node_type());
-                    added_old_status.push_back(kv.second);
-                }
-                nfa[now_new_status].add_trans(kv.first, iter->second);
-            }
-            ++new_status_ind;
+        auto reach = [&](Status_t s) {
+            if (fragment_index.insert({ s, fragment.size() }).second)
+                fragment.push_back(s);
+        };
+        reach(rep_range.elems.first);
+        for (UInt i = 0; i != fragment.size(); ++i) {
+            auto& node = nfa[fragment[i]];
+            for (Status_t target : node.get_empty_trans())
+                reach(target);
+            for (auto& kv : node.get_trans())
+                reach(kv.second);
         }
-        new_end_ind = old_to_new_status[rep_range.elems.second] - new_status_beg;
+        assert(fragment_index.count(rep_range.elems.second));
 
-        return new_status_ind;
+        for (const NFA_counter& counter : counters) {
+            if (fragment_index.count(counter.enter))
+                return true;
+        }
+        return false;
     }
 
-    void expand_other(Status_t new_status_beg, Status_t new_status_size, int expand_times, NFA_node_set rep_range)
+    /**
+     * @brief copy the status of the sub regex after the nfa, the counted repeats in it are copied too
+     *
+     * @return the begin status and the end status of the copy
+     */
+    std::pair<Status_t, Status_t> copy_fragment(const NFA_node_set& rep_range, const Vector<Status_t>& fragment,
+                                                const Hash_map<Status_t, Status_t>& fragment_index)
     {
-        nfa.resize(nfa.size() + expand_times * new_status_size);
-        for (Status_t expand_status_beg = new_status_beg + new_status_size; expand_times-- != 0;
-             expand_status_beg += new_status_size) {
-            Status_t expand_status_ind = 0;
-            for (Status_t new_status_ind = 0; new_status_ind != new_status_size; ++new_status_ind) {
-                Status_t now_expand_status = expand_status_beg + expand_status_ind;
-                Status_t now_copy_status = new_status_beg + new_status_ind;
-
-                nfa[now_expand_status].set_node_type(nfa[now_copy_status].get_node_type());
+        const Status_t base = nfa.size();
+        nfa.resize(nfa.size() + fragment.size());
+        for (UInt i = 0; i != fragment.size(); ++i) {
+            auto& node = nfa[base + i];
+            node = nfa[fragment[i]];
+            for (Status_t& target : node.get_empty_trans())
+                target = base + fragment_index.at(target);
+            for (auto& kv : node.get_trans())
+                kv.second = base + fragment_index.at(kv.second);
+        }
 
-                auto& empty_trans = nfa[now_expand_status].get_empty_trans();
-                empty_trans = nfa[new_status_beg + new_status_ind].get_empty_trans();
-                std::for_each(empty_trans.begin(), empty_trans.end(),
-                              [=](Status_t& i) { i = expand_status_beg + i - new_status_beg; });
-                auto& trans = nfa[now_expand_status].get_trans();
-                trans = nfa[now_copy_status].get_trans();
-                std::for_each(trans.begin(), trans.end(), [=](std::pair<const Char_t, Status_t>& kv) {
-                    kv.second = expand_status_beg + kv.second - new_status_beg;
-                });
-                ++expand_status_ind;
-            }
+        for (UInt i = 0, counter_num = counters.size(); i != counter_num; ++i) {
+            auto iter = fragment_index.find(counters[i].enter);
+            if (iter == fragment_index.end())
+                continue;
+            NFA_counter counter = counters[i];
+            counter.enter = base + iter->second;
+            counter.check = base + fragment_index.at(counter.check);
+            counters.push_back(counter);
         }
+        return { base + fragment_index.at(rep_range.elems.first), base + fragment_index.at(rep_range.elems.second) };
     }
 
-    void link_all_status(Status_t new_status_beg, Status_t new_status_size, Status_t new_end_ind,
-                         NFA_node_set rep_range)
+    /**
+     * @brief X{min,max} by copies of X, X is the first copy
+     */
+    void expand_repeat(NFA_node_set& rep_range, const Vector<Status_t>& fragment,
+                       const Hash_map<Status_t, Status_t>& fragment_index, UInt min, UInt max)
     {
-        nfa[rep_range.elems.second].add_empty_trans(new_status_beg);
-        for (Status_t end = new_status_beg + new_end_ind, next_beg = new_status_beg + new_status_size;
-             next_beg < nfa.size(); end += new_status_size, next_beg += new_status_size) {
-            nfa[end].add_empty_trans(next_beg);
+        const UInt copies = max == NFA_counter::NO_LIMIT ? min : max;
+        Vector<std::pair<Status_t, Status_t>> ends;
+        if (copies != 0)
+            ends.push_back(rep_range.elems);
+        for (UInt i = 1; i < copies; ++i)
+            ends.push_back(copy_fragment(rep_range, fragment, fragment_index));
+
+        // the empty trans to one more X goes first, so the Pike VM prefers more X (greedy)
+        const Status_t beg = nfa.size();
+        nfa.resize(nfa.size() + 2);
+        if (copies != 0)
+            nfa[beg].add_empty_trans(ends[0].first);
+        if (min == 0)
+            nfa[beg].add_empty_trans(beg + 1);
+        if (max == NFA_counter::NO_LIMIT)
+            nfa[ends.back().second].add_empty_trans(ends.back().first);
+        for (UInt i = 0; i != copies; ++i) {
+            if (i + 1 != copies)
+                nfa[ends[i].second].add_empty_trans(ends[i + 1].first);
+            if (i + 1 >= min)
+                nfa[ends[i].second].add_empty_trans(beg + 1);
         }
+        rep_range.elems.first = beg;
+        rep_range.elems.second = beg + 1;
     }
 
-    void generate_rep_for_trans(Status_t new_status_beg, Status_t new_status_size, Status_t new_end_ind, UInt nums[2],
-                                NFA_node_set rep_range)
+    /**
+     * @brief X{min,max} by the counter status:
+     *        begin -> enter -> X -> check -(again)-> X, check -(end)-> end, and begin -> end if min == 0
+     */
+    void count_repeat(NFA_node_set& rep_range, UInt min, UInt max)
     {
-        Status_t all_status_end = new_status_beg + new_end_ind + new_status_size * (nums[1] - 2);
-        if (nums[0] == 0)
-            nfa[rep_range.elems.first].add_empty_trans(all_status_end);
-        for (Status_t beg = new_status_beg + new_status_size * (nums[0] - 1);
-             beg != new_status_beg + new_status_size * (nums[1] - 1); beg += new_status_size)
-            nfa[beg].add_empty_trans(all_status_end);
+        const Status_t beg = nfa.size(), enter = beg + 1, check = beg + 2, end = beg + 3;
+        nfa.resize(nfa.size() + 4);
+        nfa[beg].add_empty_trans(enter);
+        if (min == 0)
+            nfa[beg].add_empty_trans(end);
+        nfa[enter].add_empty_trans(rep_range.elems.first);
+        nfa[rep_range.elems.second].add_empty_trans(check);
+        nfa[check].add_empty_trans(rep_range.elems.first);
+        nfa[check].add_empty_trans(end);
+        counters.push_back(NFA_counter{ enter, check, min, max });
+        rep_range.elems.first = beg;
+        rep_range.elems.second = end;
     }
 
-    void act_range(Vector<NFA_node_set>& stack, Status_t& token, Regex_lexer<Char_t, std::stringstream>& lexer)
+    template <typename Lexer>
+    void act_range(Vector<NFA_node_set>& stack, Status_t& token, Lexer& lexer)
     {
         assert(token == SIGN_LEFT_SQUBRACE);
         Status_t now_status = nfa.size();
@@ -954,7 +1214,9 @@ private:
         static const Vector<Status_t> R_to_f0repfor{ ACTION_REP_FOR };
         // static const Vector<Status_t> R_to_nop{};
 
-        static const Vector<Status_t> F_to_s0lfbrack_E_s0rtbrack{ SIGN_LEFT_BRACKET, STATUS_E, SIGN_RIGHT_BRACKET };
+        static const Vector<Status_t> F_to_s0lfbrack_f0groupbeg_E_s0rtbrack_f0groupend{
+            SIGN_LEFT_BRACKET, ACTION_GROUP_BEGIN, STATUS_E, SIGN_RIGHT_BRACKET, ACTION_GROUP_END
+        };
         static const Vector<Status_t> F_to_f0alpha{ ACTION_ALPHA };
         static const Vector<Status_t> F_to_f0anyalpha{ ACTION_ANY_ALPHA };
         static const Vector<Status_t> F_to_f0range{ ACTION_RANGE };
@@ -1002,7 +1264,7 @@ private:
         ptable[STATUS_R].trans.insert({ SIGN_LEFT_SQUBRACE, &ANY_to_nop });
 
         ptable[STATUS_F].alpha_trans = &F_to_f0alpha;
-        ptable[STATUS_F].trans.insert({ SIGN_LEFT_BRACKET, &F_to_s0lfbrack_E_s0rtbrack });
+        ptable[STATUS_F].trans.insert({ SIGN_LEFT_BRACKET, &F_to_s0lfbrack_f0groupbeg_E_s0rtbrack_f0groupend });
         ptable[STATUS_F].trans.insert({ SIGN_DOT, &F_to_f0anyalpha });
         ptable[STATUS_F].trans.insert({ SIGN_LEFT_SQUBRACE, &F_to_f0range });
 
@@ -1027,25 +1289,53 @@ private:
     static constexpr Status_t ACTION_ANY_ALPHA = action_index_to_status(6);
     static constexpr Status_t ACTION_REP_FOR = action_index_to_status(7);
     static constexpr Status_t ACTION_RANGE = action_index_to_status(8);
+    static constexpr Status_t ACTION_GROUP_BEGIN = action_index_to_status(9);
+    static constexpr Status_t ACTION_GROUP_END = action_index_to_status(10);
 
     static constexpr UInt LEXER_BUFF_SIZE = Regex_lexer<Char_t, std::istream>::BUFF_SIZE;
-    static Char_t lexer_buff_memory[LEXER_BUFF_SIZE];
     static const Vector<Status_t> Production_FAILURE;
     static Vector<Regex_LL1_trans> predicion_table;
 
     Vector<NFA_node<Char_t>> nfa;
+    Vector<NFA_counter> counters;
     Status_t start_status;
     Small_vector_as_vec<Status_t> accept_state;
+    NFA_program<Char_t> program;
+    Bit_parallel_nfa<Char_t> bit_parallel;
+    Byte_classes byte_classes;
+    UInt lazy_dfa_cache_limit = Lazy_dfa<Char_t>::DEFAULT_CACHE_LIMIT;
+    size_t lazy_dfa_id = next_lazy_dfa_id();
+    Dense_dfa<Char_t> dense_dfa;
+    Find_dfa<Char_t> find_dfa;
+    Literal_prefilter<Char_t> prefilter;
+    Pike_vm<Char_t> pike_vm;
+    Tagged_dfa<Char_t> tagged_dfa;
+    UInt group_total = 0;
+    Vector<UInt> group_stack;
 };
 template <typename Char_t>
-Char_t Basic_regex<Char_t>::lexer_buff_memory[LEXER_BUFF_SIZE];
-template <typename Char_t>
 const Vector<Status_t> Basic_regex<Char_t>::Production_FAILURE{};
 template <>
 Vector<Basic_regex<Char>::Regex_LL1_trans> Basic_regex<Char>::predicion_table{ init_predicion_table() };
 
 using Regex = Basic_regex<Char>;
 
+/**
+ * @brief the engines that Basic_regex_match can run a Basic_regex with
+ *
+ * NFA      : simulate the NFA of the regex, with bit operations if the regex has few char trans (Bit_parallel_nfa)
+ * LAZY_DFA : run the DFA determinized from the NFA on demand, the DFA status are cached in the Match_scratch,
+ *            the overloads without a scratch use a scratch owned by the calling thread,
+ *            the counts of the counted repeats are kept in the DFA status, so a repeat with a big max is run
+ *            by the DFA too, the cache is flushed more often then
+ * DFA      : run the DFA built by Basic_regex::compile_dfa, fall back to NFA if there is no such DFA
+ */
+struct Match_engine {
+    static constexpr UInt NFA = 0;
+    static constexpr UInt LAZY_DFA = 1;
+    static constexpr UInt DFA = 2;
+};
+
 /**
  * @brief match the string with Basic_regex<Char_t>
  *
@@ -1059,10 +1349,59 @@ class Basic_regex_match
     static_assert(is_same_v<Char_t, Char>, "Basic_regex_match only support the type Char");
 
     template <typename Iter>
-    friend std::pair<Iter, bool> regex_match(Regex& regex_nfa, Iter beg, Iter end);
+    friend std::pair<Iter, bool> regex_match(const Regex& regex_nfa, Iter beg, Iter end);
+
+    template <typename Iter>
+    friend std::pair<Iter, size_t> regex_search(const Regex& regex_nfa, Iter beg, Iter end);
 
     template <typename Iter>
-    friend std::pair<Iter, size_t> regex_search(Regex& regex_nfa, Iter beg, Iter end);
+    friend std::pair<Iter, bool> regex_match(const Regex& regex_nfa, Iter beg, Iter end, UInt engine);
+
+    template <typename Iter>
+    friend std::pair<Iter, size_t> regex_search(const Regex& regex_nfa, Iter beg, Iter end, UInt engine);
+
+    template <typename Iter>
+    friend std::pair<Iter, bool> regex_match(const Regex& regex_nfa, Iter beg, Iter end, UInt engine,
+                                             Match_scratch<Char>& scratch);
+
+    template <typename Iter>
+    friend std::pair<Iter, size_t> regex_search(const Regex& regex_nfa, Iter beg, Iter end, UInt engine,
+                                                Match_scratch<Char>& scratch);
+
+    template <typename Iter>
+    friend std::pair<Iter, bool> regex_match(const Regex& regex_nfa, Iter beg, Iter end, Match_scratch<Char>& scratch);
+
+    template <typename Iter>
+    friend std::pair<Iter, Iter> regex_find(const Regex& regex_nfa, Iter beg, Iter end);
+
+    template <typename Iter>
+    friend std::pair<Iter, Iter> regex_find(const Regex& regex_nfa, Iter beg, Iter end, Match_scratch<Char>& scratch);
+
+    template <typename Iter>
+    friend std::pair<Iter, size_t> regex_search(const Regex& regex_nfa, Iter beg, Iter end,
+                                                Match_scratch<Char>& scratch);
+
+    template <typename Iter>
+    friend std::pair<Iter, bool> regex_match(const Regex& regex_nfa, Iter beg, Iter end, Vector<Match_span>& groups);
+
+    template <typename Iter>
+    friend std::pair<Iter, size_t> regex_search(const Regex& regex_nfa, Iter beg, Iter end,
+                                                Vector<Match_span>& groups);
+
+    template <typename Iter>
+    friend std::pair<Iter, Iter> regex_find(const Regex& regex_nfa, Iter beg, Iter end, Vector<Match_span>& groups);
+
+    template <typename Iter>
+    friend std::pair<Iter, bool> regex_match(const Regex& regex_nfa, Iter beg, Iter end, Vector<Match_span>& groups,
+                                             Match_scratch<Char>& scratch);
+
+    template <typename Iter>
+    friend std::pair<Iter, size_t> regex_search(const Regex& regex_nfa, Iter beg, Iter end,
+                                                Vector<Match_span>& groups, Match_scratch<Char>& scratch);
+
+    template <typename Iter>
+    friend std::pair<Iter, Iter> regex_find(const Regex& regex_nfa, Iter beg, Iter end, Vector<Match_span>& groups,
+                                            Match_scratch<Char>& scratch);
 
 public:
     using action_t = std::function<Identi_action>;
@@ -1088,53 +1427,620 @@ public:
     }
 
     template <typename Iter>
-    std::pair<Return_type, bool> match_for(Basic_regex<Char_t>& regex_nfa, Iter beg, Iter end) const
+    std::pair<Return_type, bool> match_for(const Basic_regex<Char_t>& regex_nfa, Iter beg, Iter end,
+                                           UInt engine = Match_engine::NFA) const
     {
-        Vector<Status_t> cur_status;
-        Vector<Status_t> empty_closure;
-        cur_status.reserve(10);
-        empty_closure.reserve(10);
-        Iter cursor = beg;
-        size_t identify_nums = 0;
-        cur_status.push_back(regex_nfa.start_status);
-        collect_empty_closure(regex_nfa, cur_status, empty_closure);
+        if (engine == Match_engine::LAZY_DFA)
+            return lazy_dfa_match_for(regex_nfa, beg, end, thread_scratch());
+        if (engine == Match_engine::DFA && regex_nfa.has_dfa())
+            return dfa_match_for(regex_nfa, beg, end);
+        if (regex_nfa.has_bit_parallel())
+            return bit_parallel_match_for(regex_nfa, beg, end);
+
+        Match_scratch<Char_t> scratch(regex_nfa);
+        return match_for(regex_nfa, beg, end, scratch);
+    }
 
-        while (cursor != end) {
-            next_status(regex_nfa, cur_status, empty_closure, cursor);
-            if (cur_status.empty())
-                return { identify_actions[0](cursor), false };
-            empty_closure.clear();
-            collect_empty_closure(regex_nfa, cur_status, empty_closure);
-            ++cursor;
-            ++identify_nums;
+    template <typename Iter>
+    std::pair<Return_type, size_t> search_for(const Basic_regex<Char_t>& regex_nfa, Iter beg, Iter end,
+                                              UInt engine = Match_engine::NFA) const
+    {
+        if (engine == Match_engine::LAZY_DFA)
+            return lazy_dfa_search_for(regex_nfa, beg, end, thread_scratch());
+        if (engine == Match_engine::DFA && regex_nfa.has_dfa())
+            return dfa_search_for(regex_nfa, beg, end);
+        if (regex_nfa.has_bit_parallel())
+            return bit_parallel_search_for(regex_nfa, beg, end);
+
+        Match_scratch<Char_t> scratch(regex_nfa);
+        return search_for(regex_nfa, beg, end, scratch);
+    }
+
+    /**
+     * @brief the same as match_for with the engine, but the NFA and the lazy DFA run in the memory of the scratch
+     */
+    template <typename Iter>
+    std::pair<Return_type, bool> match_for(const Basic_regex<Char_t>& regex_nfa, Iter beg, Iter end, UInt engine,
+                                           Match_scratch<Char_t>& scratch) const
+    {
+        if (engine == Match_engine::LAZY_DFA)
+            return lazy_dfa_match_for(regex_nfa, beg, end, scratch);
+        if (engine == Match_engine::DFA && regex_nfa.has_dfa())
+            return dfa_match_for(regex_nfa, beg, end);
+        return match_for(regex_nfa, beg, end, scratch);
+    }
+
+    /**
+     * @brief the same as search_for with the engine, but the NFA and the lazy DFA run in the memory of the scratch
+     */
+    template <typename Iter>
+    std::pair<Return_type, size_t> search_for(const Basic_regex<Char_t>& regex_nfa, Iter beg, Iter end, UInt engine,
+                                              Match_scratch<Char_t>& scratch) const
+    {
+        if (engine == Match_engine::LAZY_DFA)
+            return lazy_dfa_search_for(regex_nfa, beg, end, scratch);
+        if (engine == Match_engine::DFA && regex_nfa.has_dfa())
+            return dfa_search_for(regex_nfa, beg, end);
+        return search_for(regex_nfa, beg, end, scratch);
+    }
+
+    /**
+     * @brief the same as match_for, but simulate the NFA in the memory of the scratch,
+     *        no allocation happens once the scratch is large enough for the regex
+     */
+    template <typename Iter>
+    std::pair<Return_type, bool> match_for(const Basic_regex<Char_t>& regex_nfa, Iter beg, Iter end,
+                                           Match_scratch<Char_t>& scratch) const
+    {
+        if (regex_nfa.has_bit_parallel())
+            return bit_parallel_match_for(regex_nfa, beg, end);
+        const NFA_program<Char_t>& program = regex_nfa.program;
+        scratch.reserve(program);
+        Thread_set& cur_threads = scratch.cur_threads;
+        Thread_set& next_threads = scratch.next_threads;
+        cur_threads.clear();
+        bool accepted = add_closure(program, cur_threads, program.start_status(), 0);
+
+        for (Iter cursor = beg; cursor != end; ++cursor) {
+            accepted = step(program, cur_threads, next_threads, *cursor);
+            if (next_threads.empty())
+                return { identify_actions[0](cursor), false };
+            cur_threads.swap(next_threads);
         }
 
-        if (std::find(empty_closure.begin(), empty_closure.end(), regex_nfa.accept_state.back()) != empty_closure.end())
-            return { identify_actions[1](cursor), true };
+        if (accepted)
+            return { identify_actions[1](end), true };
         else
-            return { identify_actions[0](cursor), false };
+            return { identify_actions[0](end), false };
     }
 
+    /**
+     * @brief the same as search_for, but simulate the NFA in the memory of the scratch,
+     *        no allocation happens once the scratch is large enough for the regex
+     */
     template <typename Iter>
-    std::pair<Return_type, size_t> search_for(Basic_regex<Char_t>& regex_nfa, Iter beg, Iter end) const
+    std::pair<Return_type, size_t> search_for(const Basic_regex<Char_t>& regex_nfa, Iter beg, Iter end,
+                                              Match_scratch<Char_t>& scratch) const
     {
-        Vector<Status_t> cur_status;
-        Hash_set<Status_t> empty_closure;
-        cur_status.reserve(10);
-        empty_closure.reserve(10);
+        if (regex_nfa.has_bit_parallel())
+            return bit_parallel_search_for(regex_nfa, beg, end);
+        const NFA_program<Char_t>& program = regex_nfa.program;
+        scratch.reserve(program);
+        Thread_set& cur_threads = scratch.cur_threads;
+        Thread_set& next_threads = scratch.next_threads;
+        cur_threads.clear();
+        add_closure(program, cur_threads, program.start_status(), 0);
+        Iter cursor = beg;
+        Iter last_accept_pos = beg;
+
+        for (; cursor != end; ++cursor) {
+            bool accepted = step(program, cur_threads, next_threads, *cursor);
+            if (next_threads.empty())
+                break;
+            if (accepted)
+                last_accept_pos = cursor + 1;
+            cur_threads.swap(next_threads);
+        }
+
+        if (last_accept_pos != beg)
+            return { identify_actions[1](last_accept_pos), size_t(cursor - beg) };
+        else
+            return { identify_actions[0](cursor), 0 };
+    }
+
+    /**
+     * @brief find the leftmost-longest (not empty) match in [beg, end) in one pass
+     *
+     *
+     * The start status is added at every char (Pike's way) until a match is found,
+     * every NFA status remembers the leftmost offset where a match that reaches it begins.
+     * After a match is found, only the matches that begin at or before it are followed.
+     *
+     * The literal prefilter of the regex is used first: there is no match if the inner literal does not occur,
+     * and the start status is only added where the prefix occurs, no status is run between them.
+     *
+     * If the regex has its Find_dfa (built by compile_dfa), the same match is found by the DFAs instead:
+     * the forward DFA to the end of the match, then the reverse DFA back to its begin.
+     *
+     * @return the span of the match, (end, end) if there is no match
+     */
+    template <typename Iter>
+    std::pair<Iter, Iter> find_for(const Basic_regex<Char_t>& regex_nfa, Iter beg, Iter end) const
+    {
+        Match_scratch<Char_t> scratch(regex_nfa);
+        return find_for(regex_nfa, beg, end, scratch);
+    }
+
+    template <typename Iter>
+    std::pair<Iter, Iter> find_for(const Basic_regex<Char_t>& regex_nfa, Iter beg, Iter end,
+                                   Match_scratch<Char_t>& scratch) const
+    {
+        return find_for(regex_nfa, beg, end, size_t(end - beg), scratch);
+    }
+
+    /**
+     * @brief the same as find_for, but only the matches that begin before beg + start_limit are found,
+     *        they may end after it, the search stops once no match that begins before it is alive
+     */
+    template <typename Iter>
+    std::pair<Iter, Iter> find_for(const Basic_regex<Char_t>& regex_nfa, Iter beg, Iter end, size_t start_limit,
+                                   Match_scratch<Char_t>& scratch) const
+    {
+        if (regex_nfa.has_find_dfa())
+            return find_dfa_find_for(regex_nfa, beg, end, start_limit);
+        return nfa_find_for(regex_nfa, beg, end, 0, start_limit, scratch, nullptr);
+    }
+
+    /**
+     * @brief the next match of Regex_iterator: the leftmost-longest match in [beg + from, end),
+     *        the offsets are from beg, and the finds before of the iterator began at beg too
+     *
+     *
+     * The NFA does not run the threads that the finds before found to fail (see Failed_threads),
+     * so all the matches of the buffer are found in O(n * program size) time.
+     * The Find_dfa can not tell the threads that fail, it is run while it stops within FIND_DFA_TAIL_LIMIT chars
+     * after the end of its match, then every find runs in O(its span + FIND_DFA_TAIL_LIMIT) time.
+     * If it runs further, use_dfa is set to false and the NFA finds the match, from now on.
+     * A find from 0 begins a new find all, the failed threads in the scratch are cleared.
+     */
+    template <typename Iter>
+    std::pair<Iter, Iter> find_next_for(const Basic_regex<Char_t>& regex_nfa, Iter beg, Iter end, size_t from,
+                                        bool& use_dfa, Match_scratch<Char_t>& scratch) const
+    {
+        if (from == 0)
+            scratch.failed_threads.clear();
+        if (use_dfa && regex_nfa.has_find_dfa()) {
+            bool finished = true;
+            auto result = find_dfa_find_for(regex_nfa, beg + from, end, size_t(end - beg) - from,
+                                            FIND_DFA_TAIL_LIMIT, finished);
+            if (finished)
+                return result;
+            use_dfa = false;
+        }
+        scratch.failed_threads.advance(from);
+        return nfa_find_for(regex_nfa, beg, end, from, size_t(end - beg), scratch, &scratch.failed_threads);
+    }
+
+    static constexpr size_t FIND_DFA_TAIL_LIMIT = 256;
+
+    /**
+     * @brief the same as find_for with the start limit on the NFA, but the search begins at beg + from,
+     *        the offsets are from beg
+     *
+     * @param failed the threads that are not run again, and the threads that fail in this find are added to it,
+     *               nullptr if the find is not a part of a find all
+     */
+    template <typename Iter>
+    std::pair<Iter, Iter> nfa_find_for(const Basic_regex<Char_t>& regex_nfa, Iter beg, Iter end, size_t from,
+                                       size_t start_limit, Match_scratch<Char_t>& scratch, Failed_threads* failed) const
+    {
+        static constexpr size_t NO_MATCH = size_t(-1);
+        const NFA_program<Char_t>& program = regex_nfa.program;
+        scratch.reserve(program);
+        Thread_set& cur_threads = scratch.cur_threads;
+        Thread_set& next_threads = scratch.next_threads;
+        const Literal_prefilter<Char_t>& prefilter = regex_nfa.prefilter;
+        const size_t size = end - beg;
+        size_t match_beg = NO_MATCH, match_end = NO_MATCH;
+        cur_threads.clear();
+        if (failed != nullptr)
+            failed->drop_log();
+        // with a start limit, the literals are not searched far after it, the search must stay near [beg, start_limit)
+        if (start_limit >= size && !prefilter.may_match(beg + from, end))
+            return { end, end };
+        const size_t prefix_end =
+            start_limit >= size ? size : std::min(size, start_limit + prefilter.prefix().size());
+        auto find_candidate = [&](size_t from) {
+            size_t found = prefilter.find_prefix(beg, beg + prefix_end, from);
+            return found < start_limit ? found : size;
+        };
+        size_t candidate = find_candidate(from);
+
+        for (size_t pos = from;; ++pos) {
+            if (match_beg == NO_MATCH) {
+                if (cur_threads.empty()) {
+                    if (candidate == size)
+                        break;
+                    pos = candidate;
+                }
+                if (pos == candidate) {
+                    add_thread(program, cur_threads, scratch.cur_starts, program.start_status(), 0, pos);
+                    candidate = find_candidate(pos + 1);
+                }
+            }
+            if (cur_threads.empty() || pos == size)
+                break;
+
+            const Char_t c = beg[pos];
+            next_threads.clear();
+            for (UInt index = 0; index != cur_threads.size(); ++index) {
+                const size_t start = scratch.cur_starts[index];
+                if (start > match_beg)
+                    break;
+                const Thread_set::Thread& thread = cur_threads[index];
+                if (failed != nullptr) {
+                    if (failed->contains(pos, thread.status, thread.count))
+                        continue;
+                    if (match_beg != NO_MATCH)
+                        failed->log(pos, thread);
+                }
+                program.for_each_trans(thread.status, c, [&](Status_t target) {
+                    if (add_thread(program, next_threads, scratch.next_starts, target, thread.count, start) &&
+                        start <= match_beg) {
+                        match_beg = start;
+                        match_end = pos + 1;
+                    }
+                });
+            }
+            // the threads run at pos are only failed when the match ends at or before pos
+            if (failed != nullptr && match_end == pos + 1)
+                failed->drop_log();
+            cur_threads.swap(next_threads);
+            scratch.cur_starts.swap(scratch.next_starts);
+        }
+
+        if (match_beg == NO_MATCH)
+            return { end, end };
+        if (failed != nullptr)
+            failed->commit_log();
+        return { beg + match_beg, beg + match_end };
+    }
+
+    /**
+     * @brief the same as match_for, search_for and find_for, and groups[i] is the span of the group i
+     *        (the i-th left bracket) of the match, groups[0] is the whole match
+     *
+     *
+     * The regex with groups is run by its Pike_vm, the others are run as usual and only have the group 0.
+     * The span of the match is the same as without the groups, the groups are the ones that a backtracking matcher
+     * would take for that span: the greedy repeats take more and the left alternative first.
+     * A group in a repeat has the span of its last run, and a group that takes no part in the match
+     * (or all the groups if there is no match) is { Match_span::NO_OFFSET, 0 }.
+     * An X that can match the empty string runs empty at most once at an offset, and a counted X{n,m}
+     * (see NFA_counter) of such an X does not run it empty to reach n.
+     *
+     * For example, a regex: ([a-z]+)=([0-9]*)
+     *              find in "x key=42;": groups = { "key=42", "key", "42" }
+     *              a regex: (a|b)+
+     *              match "ab": groups = { "ab", "b" }
+     */
+    template <typename Iter>
+    std::pair<Return_type, bool> match_for(const Basic_regex<Char_t>& regex_nfa, Iter beg, Iter end,
+                                           Vector<Match_span>& groups) const
+    {
+        Match_scratch<Char_t> scratch(regex_nfa);
+        return match_for(regex_nfa, beg, end, groups, scratch);
+    }
+
+    template <typename Iter>
+    std::pair<Return_type, size_t> search_for(const Basic_regex<Char_t>& regex_nfa, Iter beg, Iter end,
+                                              Vector<Match_span>& groups) const
+    {
+        Match_scratch<Char_t> scratch(regex_nfa);
+        return search_for(regex_nfa, beg, end, groups, scratch);
+    }
+
+    template <typename Iter>
+    std::pair<Iter, Iter> find_for(const Basic_regex<Char_t>& regex_nfa, Iter beg, Iter end,
+                                   Vector<Match_span>& groups) const
+    {
+        Match_scratch<Char_t> scratch(regex_nfa);
+        return find_for(regex_nfa, beg, end, groups, scratch);
+    }
+
+    template <typename Iter>
+    std::pair<Return_type, bool> match_for(const Basic_regex<Char_t>& regex_nfa, Iter beg, Iter end,
+                                           Vector<Match_span>& groups, Match_scratch<Char_t>& scratch) const
+    {
+        if (regex_nfa.group_num() == 0) {
+            groups.assign(1, Match_span{ Match_span::NO_OFFSET, 0 });
+            auto result = match_for(regex_nfa, beg, end, scratch);
+            if (result.second)
+                groups[0] = Match_span{ 0, size_t(end - beg) };
+            return result;
+        }
+        const size_t stop =
+            regex_nfa.has_tagged_dfa()
+                ? regex_nfa.tagged_dfa.match(beg, end, scratch, groups)
+                : regex_nfa.pike_vm.run(regex_nfa.program, regex_nfa.prefilter, beg, end, Pike_vm<Char_t>::MATCH,
+                                        scratch, groups);
+        if (groups[0].matched())
+            return { identify_actions[1](end), true };
+        return { identify_actions[0](beg + stop), false };
+    }
+
+    template <typename Iter>
+    std::pair<Return_type, size_t> search_for(const Basic_regex<Char_t>& regex_nfa, Iter beg, Iter end,
+                                              Vector<Match_span>& groups, Match_scratch<Char_t>& scratch) const
+    {
+        if (regex_nfa.group_num() == 0 || regex_nfa.has_tagged_dfa()) {
+            // the search of the plain iterators succeeds when it has read some chars
+            auto result = regex_nfa.has_dfa()
+                              ? simple_regex_match<Iter>().search_for(regex_nfa, beg, end, Match_engine::DFA)
+                              : simple_regex_match<Iter>().search_for(regex_nfa, beg, end, scratch);
+            tagged_dfa_groups(regex_nfa, beg, beg, result.second != 0 ? result.first : beg, scratch, groups);
+            return { identify_actions[result.second != 0](result.first), result.second };
+        }
+        const size_t stop =
+            regex_nfa.pike_vm.run(regex_nfa.program, regex_nfa.prefilter, beg, end, Pike_vm<Char_t>::SEARCH, scratch,
+                                  groups);
+        if (groups[0].matched())
+            return { identify_actions[1](beg + groups[0].length), stop };
+        return { identify_actions[0](beg + stop), 0 };
+    }
+
+    template <typename Iter>
+    std::pair<Iter, Iter> find_for(const Basic_regex<Char_t>& regex_nfa, Iter beg, Iter end,
+                                   Vector<Match_span>& groups, Match_scratch<Char_t>& scratch) const
+    {
+        if (regex_nfa.group_num() == 0 || regex_nfa.has_tagged_dfa()) {
+            auto result = find_for(regex_nfa, beg, end, scratch);
+            tagged_dfa_groups(regex_nfa, beg, result.first, result.second, scratch, groups);
+            return result;
+        }
+        regex_nfa.pike_vm.run(regex_nfa.program, regex_nfa.prefilter, beg, end, Pike_vm<Char_t>::FIND, scratch,
+                              groups);
+        if (!groups[0].matched())
+            return { end, end };
+        return { beg + groups[0].offset, beg + groups[0].offset + groups[0].length };
+    }
+
+    template <typename Iter>
+    static std::pair<Iter, bool> match(const Basic_regex<Char_t>& regex_nfa, Iter beg, Iter end,
+                                       UInt engine = Match_engine::NFA)
+    {
+        return simple_regex_match<Iter>().match_for(regex_nfa, beg, end, engine);
+    }
+
+    template <typename Iter>
+    static std::pair<Iter, size_t> search(const Basic_regex<Char_t>& regex_nfa, Iter beg, Iter end,
+                                          UInt engine = Match_engine::NFA)
+    {
+        return simple_regex_match<Iter>().search_for(regex_nfa, beg, end, engine);
+    }
+
+    template <typename Iter>
+    static std::pair<Iter, bool> match(const Basic_regex<Char_t>& regex_nfa, Iter beg, Iter end,
+                                       Match_scratch<Char_t>& scratch)
+    {
+        return simple_regex_match<Iter>().match_for(regex_nfa, beg, end, scratch);
+    }
+
+    template <typename Iter>
+    static std::pair<Iter, size_t> search(const Basic_regex<Char_t>& regex_nfa, Iter beg, Iter end,
+                                          Match_scratch<Char_t>& scratch)
+    {
+        return simple_regex_match<Iter>().search_for(regex_nfa, beg, end, scratch);
+    }
+
+    template <typename Iter>
+    static std::pair<Iter, bool> match(const Basic_regex<Char_t>& regex_nfa, Iter beg, Iter end, UInt engine,
+                                       Match_scratch<Char_t>& scratch)
+    {
+        return simple_regex_match<Iter>().match_for(regex_nfa, beg, end, engine, scratch);
+    }
+
+    template <typename Iter>
+    static std::pair<Iter, size_t> search(const Basic_regex<Char_t>& regex_nfa, Iter beg, Iter end, UInt engine,
+                                          Match_scratch<Char_t>& scratch)
+    {
+        return simple_regex_match<Iter>().search_for(regex_nfa, beg, end, engine, scratch);
+    }
+
+    template <typename Iter>
+    static std::pair<Iter, Iter> find(const Basic_regex<Char_t>& regex_nfa, Iter beg, Iter end)
+    {
+        return simple_regex_match<Iter>().find_for(regex_nfa, beg, end);
+    }
+
+    template <typename Iter>
+    static std::pair<Iter, Iter> find(const Basic_regex<Char_t>& regex_nfa, Iter beg, Iter end,
+                                      Match_scratch<Char_t>& scratch)
+    {
+        return simple_regex_match<Iter>().find_for(regex_nfa, beg, end, scratch);
+    }
+
+    template <typename Iter>
+    static std::pair<Iter, Iter> find(const Basic_regex<Char_t>& regex_nfa, Iter beg, Iter end, size_t start_limit,
+                                      Match_scratch<Char_t>& scratch)
+    {
+        return simple_regex_match<Iter>().find_for(regex_nfa, beg, end, start_limit, scratch);
+    }
+
+    template <typename Iter>
+    static std::pair<Iter, Iter> find_next(const Basic_regex<Char_t>& regex_nfa, Iter beg, Iter end, size_t from,
+                                           bool& use_dfa, Match_scratch<Char_t>& scratch)
+    {
+        return simple_regex_match<Iter>().find_next_for(regex_nfa, beg, end, from, use_dfa, scratch);
+    }
+
+private:
+    /**
+     * @brief insert the threads of the closure of the status with the count into the set
+     *
+     * @return true if an accept status is inserted
+     */
+    static bool add_closure(const NFA_program<Char_t>& program, Thread_set& set, Status_t status, UInt count)
+    {
+        bool accepted = false;
+        program.for_each_closure(status, count, [&](Status_t s, UInt s_count) {
+            if (!set.insert(s, s_count))
+                return false;
+            if (program.is_accept(s))
+                accepted = true;
+            return true;
+        });
+        return accepted;
+    }
+
+    /**
+     * @brief insert the threads of the closure of the status with the count into the set, the new threads begin at start,
+     *        starts[i] is the begin of the thread set[i]
+     *
+     * @return true if an accept status is inserted
+     */
+    static bool add_thread(const NFA_program<Char_t>& program, Thread_set& set, Vector<size_t>& starts,
+                           Status_t status, UInt count, size_t start)
+    {
+        bool accepted = false;
+        program.for_each_closure(status, count, [&](Status_t s, UInt s_count) {
+            if (!set.insert(s, s_count))
+                return false;
+            Match_scratch<Char_t>::grow(starts, set.size());
+            starts[set.size() - 1] = start;
+            if (program.is_accept(s))
+                accepted = true;
+            return true;
+        });
+        return accepted;
+    }
+
+    /**
+     * @brief next_set = the closures of the status that the threads of cur_set trans to with char c
+     *
+     * @return true if next_set accepts
+     */
+    static bool step(const NFA_program<Char_t>& program, const Thread_set& cur_set, Thread_set& next_set, Char_t c)
+    {
+        bool accepted = false;
+        next_set.clear();
+        for (const Thread_set::Thread& thread : cur_set) {
+            program.for_each_trans(thread.status, c, [&](Status_t target) {
+                if (add_closure(program, next_set, target, thread.count))
+                    accepted = true;
+            });
+        }
+        return accepted;
+    }
+
+    /**
+     * @brief the groups of the match [match_beg, match_end) found by the other engines,
+     *        by the tagged DFA if the regex has one, with the offsets from beg
+     */
+    template <typename Iter>
+    static void tagged_dfa_groups(const Basic_regex<Char_t>& regex_nfa, Iter beg, Iter match_beg, Iter match_end,
+                                  Match_scratch<Char_t>& scratch, Vector<Match_span>& groups)
+    {
+        if (match_beg == match_end) {
+            groups.assign(regex_nfa.group_num() + 1, Match_span{ Match_span::NO_OFFSET, 0 });
+            return;
+        }
+        if (!regex_nfa.has_tagged_dfa()) {
+            groups.assign(1, Match_span{ 0, size_t(match_end - match_beg) });
+        } else {
+            regex_nfa.tagged_dfa.match(match_beg, match_end, scratch, groups);
+            assert(groups[0].matched());
+        }
+        const size_t offset = match_beg - beg;
+        for (Match_span& group : groups) {
+            if (group.matched())
+                group.offset += offset;
+        }
+    }
+
+    /**
+     * @brief the same as match_for, but run the Bit_parallel_nfa of the regex
+     */
+    template <typename Iter>
+    std::pair<Return_type, bool> bit_parallel_match_for(const Basic_regex<Char_t>& regex_nfa, Iter beg, Iter end) const
+    {
+        auto result = regex_nfa.bit_parallel.match(beg, end);
+        return { identify_actions[result.second](result.first), result.second };
+    }
+
+    /**
+     * @brief the same as search_for, but run the Bit_parallel_nfa of the regex
+     */
+    template <typename Iter>
+    std::pair<Return_type, size_t> bit_parallel_search_for(const Basic_regex<Char_t>& regex_nfa, Iter beg,
+                                                           Iter end) const
+    {
+        auto result = regex_nfa.bit_parallel.search(beg, end);
+        if (result.first != beg)
+            return { identify_actions[1](result.first), size_t(result.second - beg) };
+        else
+            return { identify_actions[0](result.second), 0 };
+    }
+
+    /**
+     * @brief the scratch of the calling thread, for the lazy DFA engine called without a scratch,
+     *        its cache is built again when the thread matches with another regex
+     */
+    static Match_scratch<Char_t>& thread_scratch()
+    {
+        static thread_local Match_scratch<Char_t> scratch;
+        return scratch;
+    }
+
+    /**
+     * @return the lazy DFA of the regex cached in the scratch, it is flushed if the scratch cached another regex
+     *         (or the regex before it is changed)
+     */
+    static Lazy_dfa<Char_t>& lazy_dfa_of(const Basic_regex<Char_t>& regex_nfa, Match_scratch<Char_t>& scratch)
+    {
+        return Match_scratch<Char_t>::cached_lazy_dfa(scratch.lazy_dfa, scratch.lazy_dfa_id, regex_nfa.lazy_dfa_id,
+                                                      regex_nfa.lazy_dfa_cache_limit, regex_nfa.byte_classes);
+    }
+
+    /**
+     * @brief the same as match_for, but run the lazy DFA cached in the scratch instead of the NFA
+     */
+    template <typename Iter>
+    std::pair<Return_type, bool> lazy_dfa_match_for(const Basic_regex<Char_t>& regex_nfa, Iter beg, Iter end,
+                                                    Match_scratch<Char_t>& scratch) const
+    {
+        Lazy_dfa<Char_t>& dfa = lazy_dfa_of(regex_nfa, scratch);
+        Status_t status = dfa.start_status(regex_nfa.program);
+        for (Iter cursor = beg; cursor != end; ++cursor) {
+            status = dfa.next_status(regex_nfa.program, status, *cursor);
+            if (dfa.is_dead(status))
+                return { identify_actions[0](cursor), false };
+        }
+
+        if (dfa.is_accept(status))
+            return { identify_actions[1](end), true };
+        else
+            return { identify_actions[0](end), false };
+    }
+
+    /**
+     * @brief the same as search_for, but run the lazy DFA cached in the scratch instead of the NFA
+     */
+    template <typename Iter>
+    std::pair<Return_type, size_t> lazy_dfa_search_for(const Basic_regex<Char_t>& regex_nfa, Iter beg, Iter end,
+                                                       Match_scratch<Char_t>& scratch) const
+    {
+        Lazy_dfa<Char_t>& dfa = lazy_dfa_of(regex_nfa, scratch);
+        Status_t status = dfa.start_status(regex_nfa.program);
         Iter cursor = beg;
         size_t identify_nums = 0;
         Iter last_accept_pos = beg;
-        cur_status.push_back(regex_nfa.start_status);
-        collect_empty_closure(regex_nfa, cur_status, empty_closure);
 
         while (cursor != end) {
-            next_status(regex_nfa, cur_status, empty_closure, cursor);
-            if (cur_status.empty())
+            status = dfa.next_status(regex_nfa.program, status, *cursor);
+            if (dfa.is_dead(status))
                 break;
-            empty_closure.clear();
-            collect_empty_closure(regex_nfa, cur_status, empty_closure);
-            if (empty_closure.find(regex_nfa.accept_state.back()) != empty_closure.end())
+            if (dfa.is_accept(status))
                 last_accept_pos = cursor + 1;
             ++cursor;
             ++identify_nums;
@@ -1146,62 +2052,121 @@ public:
             return { identify_actions[0](cursor), 0 };
     }
 
+    /**
+     * @brief the same as match_for, but run the DFA built by Basic_regex::compile_dfa
+     */
     template <typename Iter>
-    static std::pair<Iter, bool> match(Basic_regex<Char_t>& regex_nfa, Iter beg, Iter end)
+    std::pair<Return_type, bool> dfa_match_for(const Basic_regex<Char_t>& regex_nfa, Iter beg, Iter end) const
     {
-        return simple_regex_match<Iter>().match_for(regex_nfa, beg, end);
+        const Dense_dfa<Char_t>& dfa = regex_nfa.dense_dfa;
+        Status_t status = dfa.start_status();
+        for (Iter cursor = beg; cursor != end; ++cursor) {
+            status = dfa.next_status(status, *cursor);
+            if (dfa.is_dead(status))
+                return { identify_actions[0](cursor), false };
+        }
+
+        if (dfa.is_accept(status))
+            return { identify_actions[1](end), true };
+        else
+            return { identify_actions[0](end), false };
     }
 
+    /**
+     * @brief the same as search_for, but run the DFA built by Basic_regex::compile_dfa
+     */
     template <typename Iter>
-    static std::pair<Iter, size_t> search(Basic_regex<Char_t>& regex_nfa, Iter beg, Iter end)
+    std::pair<Return_type, size_t> dfa_search_for(const Basic_regex<Char_t>& regex_nfa, Iter beg, Iter end) const
     {
-        return simple_regex_match<Iter>().search_for(regex_nfa, beg, end);
-    }
+        const Dense_dfa<Char_t>& dfa = regex_nfa.dense_dfa;
+        Status_t status = dfa.start_status();
+        Iter cursor = beg;
+        Iter last_accept_pos = beg;
 
-private:
-    template <typename Vec_or_HashSet>
-    void next_status(Basic_regex<Char_t>& regex_nfa, Vector<Status_t>& cur_status, Vec_or_HashSet& empty_closure,
-                     const Char_t* cursor) const
-    {
-        for (auto status : empty_closure) {
-            auto& node = regex_nfa.nfa[status];
-            auto result = node.trans_to(*cursor);
-            if (result.first)
-                cur_status.push_back(result.second);
+        for (; cursor != end; ++cursor) {
+            status = dfa.next_status(status, *cursor);
+            if (dfa.is_dead(status))
+                break;
+            if (dfa.is_accept(status))
+                last_accept_pos = cursor + 1;
         }
+
+        if (last_accept_pos != beg)
+            return { identify_actions[1](last_accept_pos), size_t(cursor - beg) };
+        else
+            return { identify_actions[0](cursor), 0 };
     }
 
-    template <typename Vec_or_HashSet>
-    void collect_empty_closure(Basic_regex<Char_t>& regex_nfa, Vector<Status_t>& source_set,
-                               Vec_or_HashSet& result) const
+    /**
+     * @brief the same as find_for, but run the Find_dfa built by Basic_regex::compile_dfa
+     *
+     *
+     * The forward DFA stops where it dies, the last end it accepts at is the end of the match.
+     * No match begins before the last char where the forward DFA was in its start status
+     * (only the group that begins there was alive), so the reverse DFA does not run back over it.
+     */
+    template <typename Iter>
+    std::pair<Iter, Iter> find_dfa_find_for(const Basic_regex<Char_t>& regex_nfa, Iter beg, Iter end,
+                                            size_t start_limit) const
     {
-        Vector<bool> visited_node(regex_nfa.nfa.size());
-        if constexpr (is_same_v<Vec_or_HashSet, Vector<Status_t>>) {
-            result.insert(result.end(), source_set.begin(), source_set.end());
-        } else {
-            result.insert(source_set.begin(), source_set.end());
-        }
+        bool finished = true;
+        return find_dfa_find_for(regex_nfa, beg, end, start_limit, size_t(-1), finished);
+    }
 
-        for (auto i : source_set)
-            visited_node[i] = true;
-        while (!source_set.empty()) {
-            Status_t status = source_set.back();
-            source_set.pop_back();
-            auto trans_iter = regex_nfa.nfa.begin() + status;
-            visited_node[status] = true;
-            if (!trans_iter->has_empty_trans())
-                continue;
-            for (auto new_status : trans_iter->get_empty_trans()) {
-                if (visited_node[new_status])
-                    continue;
-                source_set.push_back(new_status);
-                if constexpr (is_same_v<Vec_or_HashSet, Vector<Status_t>>) {
-                    result.push_back(new_status);
-                } else {
-                    result.insert(new_status);
-                }
+    /**
+     * @brief the same as find_dfa_find_for, but give up (finished = false) if the forward DFA is still alive
+     *        more than tail_limit chars after the end of the match it has found
+     */
+    template <typename Iter>
+    std::pair<Iter, Iter> find_dfa_find_for(const Basic_regex<Char_t>& regex_nfa, Iter beg, Iter end,
+                                            size_t start_limit, size_t tail_limit, bool& finished) const
+    {
+        static constexpr size_t NO_MATCH = size_t(-1);
+        const Find_dfa<Char_t>& dfa = regex_nfa.find_dfa;
+        const Literal_prefilter<Char_t>& prefilter = regex_nfa.prefilter;
+        const size_t size = end - beg;
+        if (start_limit >= size && !prefilter.may_match(beg, end))
+            return { end, end };
+        const size_t prefix_end =
+            start_limit >= size ? size : std::min(size, start_limit + prefilter.prefix().size());
+        const size_t begin_limit = std::min(size, start_limit);
+
+        Status_t status = dfa.start_status();
+        size_t floor = 0, match_end = NO_MATCH;
+        for (size_t pos = 0;; ++pos) {
+            if (pos == start_limit)
+                status = dfa.close_status(status);
+            if (status == dfa.start_status()) {
+                pos = prefilter.find_prefix(beg, beg + prefix_end, pos);
+                if (pos >= begin_limit)
+                    break;
+                floor = pos;
+            }
+            if (dfa.is_dead(status) || pos == size)
+                break;
+            status = dfa.next_status(status, beg[pos]);
+            if (dfa.is_accept(status))
+                match_end = pos + 1;
+            else if (match_end != NO_MATCH && pos + 1 - match_end > tail_limit) {
+                finished = false;
+                return { end, end };
             }
         }
+        if (match_end == NO_MATCH)
+            return { end, end };
+
+        const Dense_dfa<Char_t>& reverse = dfa.reverse_dfa();
+        status = reverse.start_status();
+        size_t match_beg = match_end;
+        for (size_t pos = match_end; pos != floor; --pos) {
+            status = reverse.next_status(status, beg[pos - 1]);
+            if (reverse.is_dead(status))
+                break;
+            if (reverse.is_accept(status))
+                match_beg = pos - 1;
+        }
+        assert(match_beg != match_end);
+        return { beg + match_beg, beg + match_end };
     }
 
     template <typename Iter>
@@ -1219,16 +2184,105 @@ template <typename Identi_action, typename Return_type>
 using Regex_match = Basic_regex_match<Char, Identi_action, Return_type>;
 
 template <typename Iter>
-static std::pair<Iter, bool> regex_match(Regex& regex_nfa, Iter beg, Iter end)
+static std::pair<Iter, bool> regex_match(const Regex& regex_nfa, Iter beg, Iter end)
 {
     return Regex_match<void, void>::simple_regex_match<Iter>().match_for(regex_nfa, beg, end);
 }
 
 template <typename Iter>
-static std::pair<Iter, size_t> regex_search(Regex& regex_nfa, Iter beg, Iter end)
+static std::pair<Iter, size_t> regex_search(const Regex& regex_nfa, Iter beg, Iter end)
 {
     return Regex_match<void, void>::simple_regex_match<Iter>().search_for(regex_nfa, beg, end);
 }
+
+template <typename Iter>
+static std::pair<Iter, bool> regex_match(const Regex& regex_nfa, Iter beg, Iter end, UInt engine)
+{
+    return Regex_match<void, void>::simple_regex_match<Iter>().match_for(regex_nfa, beg, end, engine);
+}
+
+template <typename Iter>
+static std::pair<Iter, size_t> regex_search(const Regex& regex_nfa, Iter beg, Iter end, UInt engine)
+{
+    return Regex_match<void, void>::simple_regex_match<Iter>().search_for(regex_nfa, beg, end, engine);
+}
+
+template <typename Iter>
+static std::pair<Iter, bool> regex_match(const Regex& regex_nfa, Iter beg, Iter end, UInt engine,
+                                         Match_scratch<Char>& scratch)
+{
+    return Regex_match<void, void>::simple_regex_match<Iter>().match_for(regex_nfa, beg, end, engine, scratch);
+}
+
+template <typename Iter>
+static std::pair<Iter, size_t> regex_search(const Regex& regex_nfa, Iter beg, Iter end, UInt engine,
+                                            Match_scratch<Char>& scratch)
+{
+    return Regex_match<void, void>::simple_regex_match<Iter>().search_for(regex_nfa, beg, end, engine, scratch);
+}
+
+template <typename Iter>
+static std::pair<Iter, bool> regex_match(const Regex& regex_nfa, Iter beg, Iter end, Match_scratch<Char>& scratch)
+{
+    return Regex_match<void, void>::simple_regex_match<Iter>().match_for(regex_nfa, beg, end, scratch);
+}
+
+template <typename Iter>
+static std::pair<Iter, size_t> regex_search(const Regex& regex_nfa, Iter beg, Iter end, Match_scratch<Char>& scratch)
+{
+    return Regex_match<void, void>::simple_regex_match<Iter>().search_for(regex_nfa, beg, end, scratch);
+}
+
+template <typename Iter>
+static std::pair<Iter, Iter> regex_find(const Regex& regex_nfa, Iter beg, Iter end)
+{
+    return Regex_match<void, void>::simple_regex_match<Iter>().find_for(regex_nfa, beg, end);
+}
+
+template <typename Iter>
+static std::pair<Iter, Iter> regex_find(const Regex& regex_nfa, Iter beg, Iter end, Match_scratch<Char>& scratch)
+{
+    return Regex_match<void, void>::simple_regex_match<Iter>().find_for(regex_nfa, beg, end, scratch);
+}
+
+template <typename Iter>
+static std::pair<Iter, bool> regex_match(const Regex& regex_nfa, Iter beg, Iter end, Vector<Match_span>& groups)
+{
+    return Regex_match<void, void>::simple_regex_match<Iter>().match_for(regex_nfa, beg, end, groups);
+}
+
+template <typename Iter>
+static std::pair<Iter, size_t> regex_search(const Regex& regex_nfa, Iter beg, Iter end, Vector<Match_span>& groups)
+{
+    return Regex_match<void, void>::simple_regex_match<Iter>().search_for(regex_nfa, beg, end, groups);
+}
+
+template <typename Iter>
+static std::pair<Iter, Iter> regex_find(const Regex& regex_nfa, Iter beg, Iter end, Vector<Match_span>& groups)
+{
+    return Regex_match<void, void>::simple_regex_match<Iter>().find_for(regex_nfa, beg, end, groups);
+}
+
+template <typename Iter>
+static std::pair<Iter, bool> regex_match(const Regex& regex_nfa, Iter beg, Iter end, Vector<Match_span>& groups,
+                                         Match_scratch<Char>& scratch)
+{
+    return Regex_match<void, void>::simple_regex_match<Iter>().match_for(regex_nfa, beg, end, groups, scratch);
+}
+
+template <typename Iter>
+static std::pair<Iter, size_t> regex_search(const Regex& regex_nfa, Iter beg, Iter end, Vector<Match_span>& groups,
+                                            Match_scratch<Char>& scratch)
+{
+    return Regex_match<void, void>::simple_regex_match<Iter>().search_for(regex_nfa, beg, end, groups, scratch);
+}
+
+template <typename Iter>
+static std::pair<Iter, Iter> regex_find(const Regex& regex_nfa, Iter beg, Iter end, Vector<Match_span>& groups,
+                                        Match_scratch<Char>& scratch)
+{
+    return Regex_match<void, void>::simple_regex_match<Iter>().find_for(regex_nfa, beg, end, groups, scratch);
+}
 }  // namespace pcc
 
 #endif  // REGEX_H_PCC_
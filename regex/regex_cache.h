@@ -0,0 +1,246 @@
+#pragma once
+#ifndef REGEX_CACHE_H_PCC_
+#define REGEX_CACHE_H_PCC_
+
+#include <atomic>
+#include <functional>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+
+#include "pcc_config.h"
+#include "pcc_template.h"
+#include "regex.h"
+
+namespace pcc
+{
+/**
+ * @brief the counters of a Regex_cache, they are read without a lock, so they may be a little behind
+ */
+struct Regex_cache_stats {
+    size_t hits;
+    size_t misses;
+    size_t evictions;
+    size_t failures;    // the misses whose pattern is a wrong regex, they are not cached
+};
+
+/**
+ * @brief a thread safe cache of compiled regex, keyed by the pattern and the flags that it is compiled with
+ *
+ *
+ * get() returns a shared_ptr to a const Basic_regex, it is never changed after it is cached,
+ * so many threads can match with it at the same time, every thread with its own Match_scratch.
+ * No engine writes to the regex while matching, the lazy DFA of Match_engine::LAZY_DFA is cached
+ * in the Match_scratch (or in a scratch of the calling thread if none is passed).
+ *
+ * The cache is split into shards by the hash of the key, every shard has its own lock and its own LRU list,
+ * so the threads that get different patterns seldom wait for each other.
+ * A pattern is compiled out of the lock. If two threads miss the same pattern at the same time,
+ * both compile it and the first one inserted is kept.
+ * Every shard keeps the memory_usage() of its regex under memory_limit / shard_num,
+ * the least recently used regex are evicted, and the regex that is just inserted is always kept.
+ * An evicted regex lives until the last shared_ptr to it is released.
+ *
+ * For example, Regex_cache cache;
+ *              auto regex = cache.get("[0-9]+", Regex_cache::COMPILE_DFA);
+ *              regex_search(*regex, beg, end, Match_engine::DFA);
+ */
+template <typename Char_t>
+class Basic_regex_cache
+{
+    static_assert(is_same_v<Char_t, Char>, "Regex_cache only support the type Char");
+
+public:
+    using Regex_ptr = std::shared_ptr<const Basic_regex<Char_t>>;
+    using String_view = std::basic_string_view<Char_t>;
+
+    /**
+     * @param memory_limit the bytes of memory that the cached regex may use in all
+     * @param shard_num the number of the shards, more shards for more threads
+     */
+    Basic_regex_cache(size_t memory_limit = DEFAULT_MEMORY_LIMIT, UInt shard_num = DEFAULT_SHARD_NUM)
+        : shards(std::max(1u, shard_num)), shard_limit(memory_limit / shards.size())
+    {
+    }
+
+    Basic_regex_cache(const Basic_regex_cache&) = delete;
+
+    Basic_regex_cache& operator=(const Basic_regex_cache&) = delete;
+
+    ~Basic_regex_cache() = default;
+
+    /**
+     * @brief get the regex of the pattern compiled with the flags, compile and cache it if it is not cached
+     *
+     * @return nullptr if the pattern is a wrong regex
+     */
+    Regex_ptr get(String_view pattern, UInt flags = 0)
+    {
+        const size_t hash = hash_key(pattern, flags);
+        Shard& shard = shards[hash % shards.size()];
+        {
+            std::lock_guard<std::mutex> lock(shard.mutex);
+            auto iter = shard.find(hash, pattern, flags);
+            if (iter != shard.lru.end()) {
+                shard.lru.splice(shard.lru.begin(), shard.lru, iter);
+                shard.hits.fetch_add(1, std::memory_order_relaxed);
+                return iter->regex;
+            }
+        }
+
+        shard.misses.fetch_add(1, std::memory_order_relaxed);
+        auto regex = std::make_shared<Basic_regex<Char_t>>();
+        if (!regex->regenetare_regex(pattern)) {
+            shard.failures.fetch_add(1, std::memory_order_relaxed);
+            return nullptr;
+        }
+        if (flags & ELIMINATE_EMPTY_TRANS)
+            regex->eliminate_empty_trans();
+        if (flags & COMPILE_DFA)
+            regex->compile_dfa();
+        Entry entry{ String(pattern), flags, hash, regex, regex->memory_usage() + pattern.size() * sizeof(Char_t) };
+
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        auto iter = shard.find(hash, pattern, flags);
+        if (iter != shard.lru.end()) {
+            shard.lru.splice(shard.lru.begin(), shard.lru, iter);
+            return iter->regex;
+        }
+        shard.used += entry.memory;
+        shard.lru.push_front(std::move(entry));
+        shard.index.insert({ hash, shard.lru.begin() });
+        while (shard.used > shard_limit && shard.lru.size() > 1)
+            shard.evict_last();
+        return shard.lru.front().regex;
+    }
+
+    /**
+     * @brief remove all the regex, the counters are kept
+     */
+    void clear()
+    {
+        for (Shard& shard : shards) {
+            std::lock_guard<std::mutex> lock(shard.mutex);
+            shard.lru.clear();
+            shard.index.clear();
+            shard.used = 0;
+        }
+    }
+
+    /**
+     * @return the number of the cached regex
+     */
+    size_t size() const
+    {
+        size_t num = 0;
+        for (const Shard& shard : shards) {
+            std::lock_guard<std::mutex> lock(shard.mutex);
+            num += shard.lru.size();
+        }
+        return num;
+    }
+
+    /**
+     * @return the bytes of memory that the cached regex use, the lazy DFA cache is not included
+     */
+    size_t memory_usage() const
+    {
+        size_t usage = 0;
+        for (const Shard& shard : shards) {
+            std::lock_guard<std::mutex> lock(shard.mutex);
+            usage += shard.used;
+        }
+        return usage;
+    }
+
+    Regex_cache_stats stats() const
+    {
+        Regex_cache_stats result{ 0, 0, 0, 0 };
+        for (const Shard& shard : shards) {
+            result.hits += shard.hits.load(std::memory_order_relaxed);
+            result.misses += shard.misses.load(std::memory_order_relaxed);
+            result.evictions += shard.evictions.load(std::memory_order_relaxed);
+            result.failures += shard.failures.load(std::memory_order_relaxed);
+        }
+        return result;
+    }
+
+    /**
+     * @brief the flags of get(), a regex is compiled by Basic_regex::eliminate_empty_trans, then Basic_regex::compile_dfa
+     */
+    static constexpr UInt COMPILE_DFA = 1;
+    static constexpr UInt ELIMINATE_EMPTY_TRANS = 1 << 1;
+
+    static constexpr size_t DEFAULT_MEMORY_LIMIT = size_t(64) << 20;
+    static constexpr UInt DEFAULT_SHARD_NUM = 16;
+
+private:
+    using String = std::basic_string<Char_t>;
+
+    struct Entry {
+        String pattern;
+        UInt flags;
+        size_t hash;
+        Regex_ptr regex;
+        size_t memory;
+    };
+
+    using Lru_list = std::list<Entry>;
+
+    /**
+     * @brief a lock, a LRU list (the most recently used first) and its index by the hash of the key
+     *
+     * The shards are aligned to the cache line, so the locks and the counters of two shards are not false shared.
+     */
+    struct alignas(64) Shard {
+        typename Lru_list::iterator find(size_t hash, String_view pattern, UInt flags)
+        {
+            auto range = index.equal_range(hash);
+            for (auto iter = range.first; iter != range.second; ++iter) {
+                if (iter->second->flags == flags && iter->second->pattern == pattern)
+                    return iter->second;
+            }
+            return lru.end();
+        }
+
+        void evict_last()
+        {
+            auto last = std::prev(lru.end());
+            auto range = index.equal_range(last->hash);
+            for (auto iter = range.first; iter != range.second; ++iter) {
+                if (iter->second == last) {
+                    index.erase(iter);
+                    break;
+                }
+            }
+            used -= last->memory;
+            lru.erase(last);
+            evictions.fetch_add(1, std::memory_order_relaxed);
+        }
+
+        mutable std::mutex mutex;
+        Lru_list lru;
+        Mul_hash_map<size_t, typename Lru_list::iterator> index;
+        size_t used = 0;
+        std::atomic<size_t> hits{ 0 };
+        std::atomic<size_t> misses{ 0 };
+        std::atomic<size_t> evictions{ 0 };
+        std::atomic<size_t> failures{ 0 };
+    };
+
+    static size_t hash_key(String_view pattern, UInt flags)
+    {
+        size_t seed = std::hash<String_view>()(pattern);
+        return seed ^ (flags + 0x9e3779b9 + (seed << 6) + (seed >> 2));
+    }
+
+    Vector<Shard> shards;
+    size_t shard_limit;
+};
+
+using Regex_cache = Basic_regex_cache<Char>;
+}  // namespace pcc
+
+#endif  // REGEX_CACHE_H_PCC_
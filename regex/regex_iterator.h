@@ -0,0 +1,146 @@
+#pragma once
+#ifndef REGEX_ITERATOR_H_PCC_
+#define REGEX_ITERATOR_H_PCC_
+
+#include <cstddef>
+#include <iterator>
+
+#include "match_scratch.h"
+#include "pcc_config.h"
+#include "regex.h"
+
+namespace pcc
+{
+/**
+ * @brief iterate all the leftmost-longest, not overlapping matches of a regex in [beg, end)
+ *
+ *
+ * Every match is searched from the end of the last match, in the memory of the scratch.
+ * A find runs on after its match until the threads of the match die, the threads that it runs there
+ * never reach an accept status again, they are kept in the scratch (see Failed_threads) and the next finds
+ * do not run them, so all the matches are found in O(n * program size) time, even for a regex like a|a*b.
+ * The Find_dfa of the regex (built by compile_dfa) is used while it stops soon after its matches,
+ * the NFA finds the rest of the matches if it does not (see Basic_regex_match::find_next_for).
+ * A match is never empty, so the iterator always moves forward.
+ * The scratch must not be used by another iterator while the iterator is used.
+ *
+ * The default constructed iterator is the end iterator.
+ *
+ * For example, a regex: [0-9]+
+ *              a buffer: "a12b345"
+ *              the matches: { 1, 2 }, { 4, 3 }
+ */
+template <typename Iter>
+class Regex_iterator
+{
+public:
+    using iterator_category = std::input_iterator_tag;
+    using value_type = Match_span;
+    using difference_type = std::ptrdiff_t;
+    using pointer = const Match_span*;
+    using reference = const Match_span&;
+
+    Regex_iterator() = default;
+
+    Regex_iterator(const Regex& regex, Iter beg, Iter end, Match_scratch<Char>& scratch)
+        : regex(&regex), beg(beg), end(end), scratch(&scratch)
+    {
+        find_from(beg);
+    }
+
+    Regex_iterator(const Regex_iterator&) = default;
+
+    Regex_iterator& operator=(const Regex_iterator&) = default;
+
+    ~Regex_iterator() = default;
+
+    reference operator*() const { return span; }
+
+    pointer operator->() const { return &span; }
+
+    Regex_iterator& operator++()
+    {
+        find_from(beg + (span.offset + span.length));
+        return *this;
+    }
+
+    Regex_iterator operator++(int)
+    {
+        Regex_iterator old = *this;
+        ++*this;
+        return old;
+    }
+
+    bool operator==(const Regex_iterator& other) const
+    {
+        if (regex == nullptr || other.regex == nullptr)
+            return regex == other.regex;
+        return span == other.span;
+    }
+
+    bool operator!=(const Regex_iterator& other) const { return !(*this == other); }
+
+private:
+    void find_from(Iter from)
+    {
+        auto result = Regex_match<void, void>::find_next(*regex, beg, end, size_t(from - beg), use_dfa, *scratch);
+        if (result.first == result.second) {
+            regex = nullptr;
+            return;
+        }
+        span.offset = result.first - beg;
+        span.length = result.second - result.first;
+    }
+
+    const Regex* regex = nullptr;
+    Iter beg;
+    Iter end;
+    Match_scratch<Char>* scratch = nullptr;
+    Match_span span{ 0, 0 };
+    bool use_dfa = true;    // the Find_dfa has stopped soon after the matches so far
+};
+
+/**
+ * @brief call callback(Match_span) for all the leftmost-longest, not overlapping matches in [beg, end)
+ *
+ * @return the number of the matches
+ */
+template <typename Iter, typename Callback>
+size_t find_all(const Regex& regex, Iter beg, Iter end, Match_scratch<Char>& scratch, Callback callback)
+{
+    size_t count = 0;
+    for (Regex_iterator<Iter> iter(regex, beg, end, scratch), iter_end; iter != iter_end; ++iter, ++count)
+        callback(*iter);
+    return count;
+}
+
+template <typename Iter, typename Callback>
+size_t find_all(const Regex& regex, Iter beg, Iter end, Callback callback)
+{
+    Match_scratch<Char> scratch(regex);
+    return find_all(regex, beg, end, scratch, callback);
+}
+
+/**
+ * @brief write the matches in [beg, end) into spans[0 ... capacity)
+ *
+ * @return the number of the spans written, if it is capacity,
+ *         the caller can go on from spans[capacity - 1].offset + spans[capacity - 1].length
+ */
+template <typename Iter>
+size_t find_all(const Regex& regex, Iter beg, Iter end, Match_scratch<Char>& scratch, Match_span* spans,
+                size_t capacity)
+{
+    size_t count = 0;
+    if (capacity == 0)
+        return 0;
+    for (Regex_iterator<Iter> iter(regex, beg, end, scratch), iter_end; iter != iter_end; ++iter) {
+        spans[count++] = *iter;
+        if (count == capacity)
+            break;
+    }
+    return count;
+}
+}  // namespace pcc
+
+#endif  // REGEX_ITERATOR_H_PCC_
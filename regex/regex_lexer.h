@@ -2,9 +2,13 @@
 #ifndef REGEX_LEXER_H_PCC_
 #define REGEX_LEXER_H_PCC_
 
+#include <string_view>
+#include <type_traits>
+
 #include "fa_status.h"
 #include "pcc_config.h"
 #include "stream_buffer.h"
+#include "view_buffer.h"
 
 namespace pcc
 {
@@ -12,6 +16,10 @@ using namespace fa_status;
 
 /**
  * @brief the lexer of regex, read input from the specified stream 
+ *
+ *
+ * If Stream is std::basic_string_view<Char_t>, the lexer reads the chars of the view directly by a View_buff,
+ * without a stream and without copying them into a buffer.
  */
 template <typename Char_t, typename Stream>
 class Regex_lexer
@@ -19,12 +27,16 @@ class Regex_lexer
     static_assert(is_same_v<Char_t, Char>, "Regex_lexer only support type of Char");
 
 public:
+    static constexpr UInt BUFF_SIZE = 1 << 8;
+
     template <typename NStream>
     Regex_lexer(Char_t* beg, Char_t* end, NStream& stream) : buff(beg, end, stream)
     {
         buff.fill_buff();
     }
 
+    Regex_lexer(std::basic_string_view<Char_t> regex) : buff(regex.data(), regex.data() + regex.size()) {}
+
     /**
      * @brief get next token from specified stream
      * 
@@ -86,8 +98,6 @@ public:
         return char_to_status(nextc);
     }
 
-    static constexpr UInt BUFF_SIZE = 1 << 8;
-
 private:
     Char_t solve_escape_char(Char_t c)
     {
@@ -122,7 +132,10 @@ private:
         return true;
     }
 
-    Stream_buff<Char_t, BUFF_SIZE, Stream> buff;
+    using Buff = std::conditional_t<std::is_same_v<Stream, std::basic_string_view<Char_t>>, View_buff<Char_t>,
+                                    Stream_buff<Char_t, BUFF_SIZE, Stream>>;
+
+    Buff buff;
 };
 }  // namespace pcc
 
@@ -0,0 +1,360 @@
+#pragma once
+#ifndef REGEX_SET_H_PCC_
+#define REGEX_SET_H_PCC_
+
+#include <algorithm>
+#include <string>
+
+#include "byte_classes.h"
+#include "fa_status.h"
+#include "lazy_dfa.h"
+#include "literal_prefilter.h"
+#include "match_scratch.h"
+#include "multi_literal.h"
+#include "nfa_program.h"
+#include "pcc_config.h"
+#include "pcc_template.h"
+#include "regex.h"
+
+namespace pcc
+{
+using namespace fa_status;
+
+/**
+ * @brief a set of regex that are matched together in one scan of the input
+ *
+ *
+ * The NFA of all the patterns are merged under one start status by NFA_program::merge,
+ * every accept status has the id of its pattern (the order the pattern was added, from 0),
+ * so one scan tells all the patterns that match.
+ *
+ * match : the patterns that match the whole input, like regex_match
+ * find  : the patterns that have a (not empty) match anywhere in the input, like regex_find
+ *
+ * The engine can be Match_engine::NFA or Match_engine::LAZY_DFA,
+ * Match_engine::DFA runs the lazy DFA too, because the minimized DFA does not keep the pattern ids.
+ * The lazy DFA is cached in the Match_scratch (of the calling thread if none is passed), so a const set
+ * can be matched from many threads at the same time.
+ *
+ * If every pattern has a literal that all its matches contain (see Literal_prefilter),
+ * find first looks for the leftmost of the literals with a Multi_literal: no pattern can match if there is none,
+ * and if the literals are all prefixes, no match begins before it, so the scan begins there.
+ *
+ * For example, the patterns: ERROR [0-9]+, WARN, [0-9]+ms
+ *              find in "ERROR 42 after 30ms" : 0, 2
+ */
+template <typename Char_t>
+class Basic_regex_set
+{
+    static_assert(is_same_v<Char_t, Char>, "Regex_set only support the type Char");
+
+public:
+    Basic_regex_set() = default;
+
+    Basic_regex_set(const Basic_regex_set&) = default;
+
+    Basic_regex_set(Basic_regex_set&&) = default;
+
+    Basic_regex_set& operator=(const Basic_regex_set&) = default;
+
+    Basic_regex_set& operator=(Basic_regex_set&&) = default;
+
+    ~Basic_regex_set() = default;
+
+    /**
+     * @brief add a pattern with the next pattern id
+     *
+     * @return false if the pattern is a wrong regex, the set is not changed
+     */
+    bool add(const Char_t* pattern)
+    {
+        Basic_regex<Char_t> regex;
+        if (!regex.regenetare_regex(pattern))
+            return false;
+        add(regex);
+        return true;
+    }
+
+    void add(const Basic_regex<Char_t>& regex)
+    {
+        programs.push_back(regex.get_program());
+        compiled = false;
+    }
+
+    /**
+     * @brief merge the patterns, it must be called after the patterns are added and before the set is matched
+     */
+    void compile()
+    {
+        Vector<const NFA_program<Char_t>*> members;
+        for (auto& program : programs)
+            members.push_back(&program);
+        anchored.merge(members, false);
+        unanchored.merge(members, true);
+        byte_classes.clear();
+        anchored.refine_classes(byte_classes);
+        unanchored.refine_classes(byte_classes);
+        anchored_dfa_id = next_lazy_dfa_id();
+        unanchored_dfa_id = next_lazy_dfa_id();
+        build_literals();
+        compiled = true;
+    }
+
+    void clear()
+    {
+        programs.clear();
+        anchored.clear();
+        unanchored.clear();
+        byte_classes.clear();
+        anchored_dfa_id = next_lazy_dfa_id();
+        unanchored_dfa_id = next_lazy_dfa_id();
+        literals.clear();
+        all_prefixes = false;
+        compiled = false;
+    }
+
+    /**
+     * @return the number of the patterns
+     */
+    size_t size() const { return programs.size(); }
+
+    bool is_compiled() const { return compiled; }
+
+    /**
+     * @return the literals that find looks for first, empty if some pattern has no literal
+     */
+    const Multi_literal& get_literals() const { return literals; }
+
+    /**
+     * @brief set the max number of DFA status cached by each of the two lazy DFA, the caches are flushed
+     */
+    void set_lazy_dfa_cache_limit(UInt limit)
+    {
+        lazy_dfa_cache_limit = limit;
+        anchored_dfa_id = next_lazy_dfa_id();
+        unanchored_dfa_id = next_lazy_dfa_id();
+    }
+
+    /**
+     * @brief matched[i] = true if the pattern i matches the whole [beg, end)
+     *
+     * @return the number of the patterns that match
+     */
+    template <typename Iter>
+    size_t match(Iter beg, Iter end, Vector<bool>& matched, UInt engine = Match_engine::NFA) const
+    {
+        return match(beg, end, matched, engine, thread_scratch());
+    }
+
+    template <typename Iter>
+    size_t match(Iter beg, Iter end, Vector<bool>& matched, Match_scratch<Char_t>& scratch) const
+    {
+        return match(beg, end, matched, Match_engine::NFA, scratch);
+    }
+
+    /**
+     * @brief the same as match with the engine, but the NFA and the lazy DFA run in the memory of the scratch
+     */
+    template <typename Iter>
+    size_t match(Iter beg, Iter end, Vector<bool>& matched, UInt engine, Match_scratch<Char_t>& scratch) const
+    {
+        matched.assign(programs.size(), false);
+        if (engine != Match_engine::NFA) {
+            Lazy_dfa<Char_t>& dfa = Match_scratch<Char_t>::cached_lazy_dfa(
+                scratch.lazy_dfa, scratch.lazy_dfa_id, anchored_dfa_id, lazy_dfa_cache_limit, byte_classes);
+            return dfa_scan<false>(dfa, anchored, beg, end, matched);
+        }
+        return nfa_scan<false>(anchored, beg, end, matched, scratch);
+    }
+
+    /**
+     * @brief matched[i] = true if the pattern i has a not empty match in [beg, end)
+     *
+     * @return the number of the patterns that match
+     */
+    template <typename Iter>
+    size_t find(Iter beg, Iter end, Vector<bool>& matched, UInt engine = Match_engine::NFA) const
+    {
+        return find(beg, end, matched, engine, thread_scratch());
+    }
+
+    template <typename Iter>
+    size_t find(Iter beg, Iter end, Vector<bool>& matched, Match_scratch<Char_t>& scratch) const
+    {
+        return find(beg, end, matched, Match_engine::NFA, scratch);
+    }
+
+    /**
+     * @brief the same as find with the engine, but the NFA and the lazy DFA run in the memory of the scratch
+     */
+    template <typename Iter>
+    size_t find(Iter beg, Iter end, Vector<bool>& matched, UInt engine, Match_scratch<Char_t>& scratch) const
+    {
+        matched.assign(programs.size(), false);
+        size_t from = prefilter(beg, end);
+        if (from == size_t(end - beg))
+            return 0;
+        if (engine != Match_engine::NFA) {
+            Lazy_dfa<Char_t>& dfa =
+                Match_scratch<Char_t>::cached_lazy_dfa(scratch.unanchored_lazy_dfa, scratch.unanchored_lazy_dfa_id,
+                                                       unanchored_dfa_id, lazy_dfa_cache_limit, byte_classes);
+            return dfa_scan<true>(dfa, unanchored, beg + from, end, matched);
+        }
+        return nfa_scan<true>(unanchored, beg + from, end, matched, scratch);
+    }
+
+    /**
+     * @return the bytes of memory that the set uses, the lazy DFA caches are in the Match_scratch
+     */
+    size_t memory_usage() const
+    {
+        size_t usage = sizeof(*this) + anchored.memory_usage() + unanchored.memory_usage() + literals.memory_usage() -
+                       sizeof(literals);
+        for (auto& program : programs)
+            usage += program.memory_usage();
+        return usage;
+    }
+
+private:
+    /**
+     * @brief the scratch of the calling thread, for match and find called without a scratch
+     */
+    static Match_scratch<Char_t>& thread_scratch()
+    {
+        static thread_local Match_scratch<Char_t> scratch;
+        return scratch;
+    }
+
+    /**
+     * @brief the literal of every pattern, the longer one of the prefix and the inner literal
+     */
+    void build_literals()
+    {
+        literals.clear();
+        all_prefixes = true;
+        Vector<std::string> pattern_literals;
+        Literal_prefilter<Char_t> prefilter;
+        for (auto& program : programs) {
+            prefilter.build(program);
+            if (prefilter.empty())
+                return;
+            all_prefixes = all_prefixes && prefilter.prefix().size() >= prefilter.inner().size();
+            pattern_literals.push_back(prefilter.prefix().size() >= prefilter.inner().size() ? prefilter.prefix()
+                                                                                              : prefilter.inner());
+        }
+        // only the leftmost occurrence is used, so which pattern a literal comes from does not matter
+        std::sort(pattern_literals.begin(), pattern_literals.end());
+        pattern_literals.erase(std::unique(pattern_literals.begin(), pattern_literals.end()), pattern_literals.end());
+        literals.build(pattern_literals);
+    }
+
+    /**
+     * @return the offset that the scan can begin at, end - beg if no pattern can have a not empty match
+     */
+    template <typename Iter>
+    size_t prefilter(Iter beg, Iter end) const
+    {
+        assert(compiled);
+        if (literals.empty())
+            return programs.empty() ? size_t(end - beg) : 0;
+        size_t offset = literals.find(beg, end, 0).offset;
+        return all_prefixes || offset == size_t(end - beg) ? offset : 0;
+    }
+
+    /**
+     * @brief simulate the merged NFA, FIND = true to mark the patterns at every char (the unanchored program),
+     *        or only at the end of the input (the anchored program)
+     */
+    template <bool FIND, typename Iter>
+    size_t nfa_scan(const NFA_program<Char_t>& program, Iter beg, Iter end, Vector<bool>& matched,
+                    Match_scratch<Char_t>& scratch) const
+    {
+        assert(compiled);
+        size_t count = 0;
+        scratch.reserve(program);
+        Thread_set& cur_threads = scratch.cur_threads;
+        Thread_set& next_threads = scratch.next_threads;
+        cur_threads.clear();
+        program.for_each_closure(program.start_status(), 0,
+                                 [&](Status_t s, UInt s_count) { return cur_threads.insert(s, s_count); });
+
+        for (Iter cursor = beg; cursor != end && !cur_threads.empty(); ++cursor) {
+            next_threads.clear();
+            for (const Thread_set::Thread& thread : cur_threads) {
+                program.for_each_trans(thread.status, *cursor, [&](Status_t target) {
+                    program.for_each_closure(target, thread.count, [&](Status_t s, UInt s_count) {
+                        if (!next_threads.insert(s, s_count))
+                            return false;
+                        if (FIND && program.is_accept(s))
+                            count += mark(matched, program.accept_id(s));
+                        return true;
+                    });
+                });
+            }
+            cur_threads.swap(next_threads);
+            if (FIND && count == matched.size())
+                return count;
+        }
+
+        if (!FIND) {
+            for (const Thread_set::Thread& thread : cur_threads) {
+                if (program.is_accept(thread.status))
+                    count += mark(matched, program.accept_id(thread.status));
+            }
+        }
+        return count;
+    }
+
+    /**
+     * @brief the same as nfa_scan, but run the lazy DFA of the merged NFA
+     */
+    template <bool FIND, typename Iter>
+    size_t dfa_scan(Lazy_dfa<Char_t>& dfa, const NFA_program<Char_t>& program, Iter beg, Iter end,
+                    Vector<bool>& matched) const
+    {
+        assert(compiled);
+        size_t count = 0;
+        Status_t status = dfa.start_status(program);
+        for (Iter cursor = beg; cursor != end; ++cursor) {
+            status = dfa.next_status(program, status, *cursor);
+            if (dfa.is_dead(status))
+                return count;
+            if (FIND && dfa.is_accept(status)) {
+                for (auto iter = dfa.patterns_begin(status); iter != dfa.patterns_end(status); ++iter)
+                    count += mark(matched, *iter);
+                if (count == matched.size())
+                    return count;
+            }
+        }
+
+        if (!FIND && dfa.is_accept(status)) {
+            for (auto iter = dfa.patterns_begin(status); iter != dfa.patterns_end(status); ++iter)
+                count += mark(matched, *iter);
+        }
+        return count;
+    }
+
+    static size_t mark(Vector<bool>& matched, UInt id)
+    {
+        if (matched[id])
+            return 0;
+        matched[id] = true;
+        return 1;
+    }
+
+    Vector<NFA_program<Char_t>> programs;
+    NFA_program<Char_t> anchored;
+    NFA_program<Char_t> unanchored;
+    Byte_classes byte_classes;
+    UInt lazy_dfa_cache_limit = Lazy_dfa<Char_t>::DEFAULT_CACHE_LIMIT;
+    size_t anchored_dfa_id = next_lazy_dfa_id();      // the ids of the lazy DFA cached in a Match_scratch
+    size_t unanchored_dfa_id = next_lazy_dfa_id();
+    Multi_literal literals;
+    bool all_prefixes = false;    // the literals are the prefixes of the patterns
+    bool compiled = false;
+};
+
+using Regex_set = Basic_regex_set<Char>;
+}  // namespace pcc
+
+#endif  // REGEX_SET_H_PCC_
@@ -0,0 +1,304 @@
+#pragma once
+#ifndef STREAM_MATCHER_H_PCC_
+#define STREAM_MATCHER_H_PCC_
+
+#include <algorithm>
+#include <cstddef>
+
+#include "fa_status.h"
+#include "literal_prefilter.h"
+#include "match_scratch.h"
+#include "nfa_program.h"
+#include "pcc_config.h"
+#include "pcc_template.h"
+#include "regex.h"
+#include "regex_iterator.h"
+
+namespace pcc
+{
+using namespace fa_status;
+
+/**
+ * @brief find the matches of a regex in a stream that is pushed chunk by chunk
+ *
+ *
+ * The matches are the same as find_all over the whole stream: leftmost-longest, not empty and not overlapping,
+ * and their offsets are from the begin of the stream.
+ * The NFA status and the offsets where their matches begin are kept between the chunks, like Basic_regex_match::find.
+ * A match is reported when it can not be longer, that is when all the status that could extend it are dead,
+ * or at finish().
+ *
+ * While no status is alive, the chars before the next prefix literal of the regex are skipped.
+ *
+ * Only the chars after the end of the pending match are kept, because the next match is searched from there
+ * once the pending match is reported. The threads run after the end of a reported match never reach an accept
+ * status, so the search from there does not run them again (see Failed_threads),
+ * and the stream is matched in O(n * program size) time.
+ *
+ * While a match could still be extended, the chars after it are kept, at most history_limit of them:
+ * when a pending match is followed by more chars, it is reported with the end it has,
+ * and the search goes on after the kept chars, the matches that would begin in them are missed.
+ * So the memory is O(history_limit + program size), and the matches are the same as find_all
+ * as long as no match is followed by more than history_limit chars that could still extend it.
+ *
+ * For example, a regex: [0-9]+
+ *              the chunks: "a12", "3b4"
+ *              the matches: { 1, 3 } (reported when 'b' is fed), { 5, 1 } (reported at finish)
+ */
+template <typename Char_t>
+class Basic_stream_matcher
+{
+    static_assert(is_same_v<Char_t, Char>, "Stream_matcher only support the type Char");
+
+public:
+    Basic_stream_matcher(const Basic_regex<Char_t>& regex)
+        : program(&regex.get_program()), prefilter(&regex.get_prefilter()), scratch(regex)
+    {
+    }
+
+    Basic_stream_matcher(const Basic_stream_matcher&) = default;
+
+    Basic_stream_matcher(Basic_stream_matcher&&) = default;
+
+    Basic_stream_matcher& operator=(const Basic_stream_matcher&) = default;
+
+    Basic_stream_matcher& operator=(Basic_stream_matcher&&) = default;
+
+    ~Basic_stream_matcher() = default;
+
+    /**
+     * @brief forget the stream, the next chunk is the begin of a new stream
+     */
+    void reset()
+    {
+        scratch.cur_threads.clear();
+        match_beg = NO_MATCH;
+        match_end = NO_MATCH;
+        pos = 0;
+        fed = 0;
+        history.clear();
+        history_offset = 0;
+        scratch.failed_threads.clear();
+    }
+
+    /**
+     * @brief set the max number of the chars kept after the pending match, see the class
+     */
+    void set_history_limit(size_t limit) { history_limit = limit; }
+
+    size_t get_history_limit() const { return history_limit; }
+
+    /**
+     * @brief feed the next chunk [beg, end) of the stream, call on_match(Match_span) for the matches decided by it
+     */
+    template <typename Iter, typename Callback>
+    void feed(Iter beg, Iter end, Callback on_match)
+    {
+        const size_t size = end - beg;
+        const size_t prefix_size = prefilter->prefix().size();
+        for (size_t i = 0; i != size;) {
+            if (prefix_size != 0 && match_beg == NO_MATCH && scratch.cur_threads.empty()) {
+                // no status is alive, skip to the next prefix, the chars a prefix may begin with at the end are kept
+                size_t next = prefilter->find_prefix(beg, end, i);
+                if (next == size)
+                    next = std::max(i, size < prefix_size ? 0 : size - prefix_size + 1);
+                pos += next - i;
+                fed += next - i;
+                i = next;
+                if (i == size)
+                    break;
+            }
+            ++fed;
+            const bool decided = step(beg[i]);
+            keep(beg[i++]);
+            if (decided)
+                report(on_match);
+        }
+    }
+
+    /**
+     * @brief the stream ends, call on_match(Match_span) for the matches that are still pending,
+     *        the matcher is reset for a new stream
+     */
+    template <typename Callback>
+    void finish(Callback on_match)
+    {
+        while (match_beg != NO_MATCH) {
+            // no more char comes, so the threads run after the pending match fail too
+            scratch.cur_threads.clear();
+            report(on_match);
+        }
+        reset();
+    }
+
+    /**
+     * @brief read the stream to its end in chunks of CHUNK_SIZE chars, and call finish
+     *
+     * The stream is read by read / gcount / eof, like Stream_buff reads C_stream and Std_stream,
+     * but a whole chunk at a time, so the input may contain the char EOF.
+     *
+     * @return the number of the matches
+     */
+    template <typename Stream, typename Callback>
+    size_t scan(Stream& stream, Callback on_match)
+    {
+        size_t count = 0;
+        auto counted = [&](const Match_span& span) {
+            ++count;
+            on_match(span);
+        };
+        chunk.resize(CHUNK_SIZE);
+        do {
+            stream.read(chunk.data(), CHUNK_SIZE);
+            feed(chunk.data(), chunk.data() + stream.gcount(), counted);
+        } while (!stream.eof() && stream.gcount() != 0);
+        finish(counted);
+        return count;
+    }
+
+    /**
+     * @return the number of the chars fed since the begin of the stream
+     */
+    size_t offset() const { return fed; }
+
+    /**
+     * @return the number of the chars kept after the pending match
+     */
+    size_t pending_size() const { return match_beg == NO_MATCH ? 0 : pos - match_end; }
+
+    static constexpr UInt CHUNK_SIZE = 1 << 16;
+    static constexpr size_t DEFAULT_HISTORY_LIMIT = 1 << 20;
+
+private:
+    static constexpr size_t NO_MATCH = size_t(-1);
+
+    /**
+     * @brief run the char at pos, the same as one step of Basic_regex_match::find
+     *
+     * @return true if the pending match can not be longer, or it is followed by more than history_limit chars
+     */
+    bool step(Char_t c)
+    {
+        Thread_set& cur_threads = scratch.cur_threads;
+        Thread_set& next_threads = scratch.next_threads;
+        Failed_threads& failed = scratch.failed_threads;
+        if (match_beg == NO_MATCH)
+            add_thread(cur_threads, scratch.cur_starts, program->start_status(), 0, pos);
+
+        bool extended = false;
+        next_threads.clear();
+        for (UInt index = 0; index != cur_threads.size(); ++index) {
+            const size_t start = scratch.cur_starts[index];
+            if (start > match_beg)
+                break;
+            const Thread_set::Thread& thread = cur_threads[index];
+            if (failed.contains(pos, thread.status, thread.count))
+                continue;
+            if (match_beg != NO_MATCH)
+                failed.log(pos, thread);
+            program->for_each_trans(thread.status, c, [&](Status_t target) {
+                if (add_thread(next_threads, scratch.next_starts, target, thread.count, start) && start <= match_beg) {
+                    match_beg = start;
+                    match_end = pos + 1;
+                    extended = true;
+                }
+            });
+        }
+        cur_threads.swap(next_threads);
+        scratch.cur_starts.swap(scratch.next_starts);
+        ++pos;
+
+        if (match_beg == NO_MATCH)
+            return false;
+        if (extended)
+            failed.drop_log();
+        return cur_threads.empty() || pos - match_end > history_limit;
+    }
+
+    /**
+     * @brief keep the char that is just fed if it is after the end of the pending match
+     */
+    void keep(Char_t c)
+    {
+        if (match_beg == NO_MATCH || match_end == pos) {
+            history.clear();
+            history_offset = pos;
+        } else {
+            history.push_back(c);
+        }
+    }
+
+    /**
+     * @brief report the pending match, and run the chars after it again to search the next match,
+     *        if the match could still be extended (the history is full),
+     *        its threads do not fail and the search goes on after the kept chars
+     */
+    template <typename Callback>
+    void report(Callback& on_match)
+    {
+        // the chars in [match_end, fed_end) are in the history, they are run again from the history in place
+        const size_t fed_end = pos;
+        for (bool decided = true; decided;) {
+            on_match(Match_span{ match_beg, match_end - match_beg });
+            if (!scratch.cur_threads.empty()) {
+                scratch.cur_threads.clear();
+                scratch.failed_threads.drop_log();
+                scratch.failed_threads.advance(fed_end);
+                pos = fed_end;
+                match_beg = NO_MATCH;
+                match_end = NO_MATCH;
+                break;
+            }
+            scratch.failed_threads.commit_log();
+            scratch.failed_threads.advance(match_end);
+            pos = match_end;
+            match_beg = NO_MATCH;
+            match_end = NO_MATCH;
+
+            decided = false;
+            while (pos != fed_end && !decided)
+                decided = step(history[pos - history_offset]);
+        }
+
+        // only the chars after the end of the pending match are kept
+        if (match_beg == NO_MATCH) {
+            history.clear();
+            history_offset = pos;
+        } else {
+            history.erase(history.begin(), history.begin() + (match_end - history_offset));
+            history_offset = match_end;
+        }
+    }
+
+    bool add_thread(Thread_set& set, Vector<size_t>& starts, Status_t status, UInt count, size_t start) const
+    {
+        bool accepted = false;
+        program->for_each_closure(status, count, [&](Status_t s, UInt s_count) {
+            if (!set.insert(s, s_count))
+                return false;
+            Match_scratch<Char_t>::grow(starts, set.size());
+            starts[set.size() - 1] = start;
+            if (program->is_accept(s))
+                accepted = true;
+            return true;
+        });
+        return accepted;
+    }
+
+    const NFA_program<Char_t>* program;
+    const Literal_prefilter<Char_t>* prefilter;
+    Match_scratch<Char_t> scratch;
+    size_t match_beg = NO_MATCH;
+    size_t match_end = NO_MATCH;
+    size_t pos = 0;    // the offset of the next char that step runs
+    size_t fed = 0;
+    size_t history_limit = DEFAULT_HISTORY_LIMIT;
+    Vector<Char_t> history;    // the chars after match_end that have been run, history[0] is at history_offset
+    size_t history_offset = 0;
+    Vector<Char_t> chunk;
+};
+
+using Stream_matcher = Basic_stream_matcher<Char>;
+}  // namespace pcc
+
+#endif  // STREAM_MATCHER_H_PCC_
@@ -0,0 +1,324 @@
+#pragma once
+#ifndef TAGGED_DFA_H_PCC_
+#define TAGGED_DFA_H_PCC_
+
+#include <algorithm>
+#include <cstddef>
+
+#include "byte_classes.h"
+#include "fa_status.h"
+#include "match_scratch.h"
+#include "pcc_config.h"
+#include "pcc_template.h"
+#include "pike_vm.h"
+
+namespace pcc
+{
+using namespace fa_status;
+
+/**
+ * @brief the tagged DFA (Laurikari's TDFA) of a regex with capture groups, it gives the same groups as the Pike_vm
+ *        of the regex for a match of the whole string in one table-driven pass
+ *
+ *
+ * A DFA status is the ordered threads of a step of the Pike_vm, every thread has a register (or none) for each slot
+ * of the groups instead of the slots themselves. The registers are numbered in the order they first appear
+ * in the threads, so two steps whose threads only have different values in the registers are the same DFA status.
+ * A trans of the DFA has the register operations of the step: the register r of the target status
+ * is set to the offset after the char, or copied from a register of the source status.
+ * Most trans in a loop copy every register to itself, they have no operation at all.
+ *
+ * The table has one column per Byte_classes class, like Dense_dfa. The DFA status 0 is the dead status.
+ * At the end of the string, the first accepting thread of the status has the registers of the groups.
+ *
+ * The subset construction is done ahead of time and gives up after state_limit status,
+ * a regex with counted repeats (see NFA_counter) is not determinized.
+ *
+ * For example, a regex: ([a-z]+)=([0-9]*)
+ *              the trans of [a-z]+ and [0-9]* are loops without operation,
+ *              the trans with '=' sets the register of the end of the group 1 and the begin of the group 2
+ */
+template <typename Char_t>
+class Tagged_dfa
+{
+public:
+    Tagged_dfa() = default;
+
+    Tagged_dfa(const Tagged_dfa&) = default;
+
+    Tagged_dfa(Tagged_dfa&&) = default;
+
+    Tagged_dfa& operator=(const Tagged_dfa&) = default;
+
+    Tagged_dfa& operator=(Tagged_dfa&&) = default;
+
+    ~Tagged_dfa() = default;
+
+    /**
+     * @brief construct the DFA from the Pike VM of the regex
+     *
+     * @return false if the regex has counted repeats or the DFA needs more than state_limit status,
+     *         the DFA is left empty
+     */
+    bool build(const Pike_vm<Char_t>& vm, const NFA_program<Char_t>& program, UInt state_limit)
+    {
+        clear();
+        if (vm.empty() || program.has_counters())
+            return false;
+        if (!subset_construct(vm, state_limit)) {
+            clear();
+            return false;
+        }
+        return true;
+    }
+
+    void clear()
+    {
+        trans.clear();
+        trans_ops.clear();
+        ops.clear();
+        accept_regs.clear();
+        final_regs.clear();
+        byte_classes.clear();
+        groups = 0;
+        reg_total = 0;
+        start_reg_num = 0;
+        start = DEAD_STATUS;
+    }
+
+    bool empty() const { return trans.empty(); }
+
+    /**
+     * @return the number of DFA status
+     */
+    size_t size() const { return accept_regs.size(); }
+
+    /**
+     * @return the max number of registers that a DFA status has
+     */
+    UInt register_num() const { return reg_total; }
+
+    /**
+     * @brief match the whole [beg, end), groups[i] = the span of the group i, all of them are NO_OFFSET if no match
+     *
+     * @return the offset of the char that the DFA dies at, or the size of [beg, end)
+     */
+    template <typename Iter>
+    size_t match(Iter beg, Iter end, Match_scratch<Char_t>& scratch, Vector<Match_span>& groups_out) const
+    {
+        groups_out.assign(groups + 1, Match_span{ Match_span::NO_OFFSET, 0 });
+        if (scratch.cur_slots.size() < reg_total) {
+            scratch.cur_slots.resize(reg_total);
+            scratch.next_slots.resize(reg_total);
+        }
+        size_t* regs = scratch.cur_slots.data();
+        size_t* next_regs = scratch.next_slots.data();
+        std::fill(regs, regs + start_reg_num, size_t(0));
+
+        const UInt class_num = byte_classes.size();
+        const size_t size = end - beg;
+        Status_t status = start;
+        for (size_t pos = 0; pos != size; ++pos) {
+            const size_t index = status + byte_classes.class_of(beg[pos]);
+            status = trans[index];
+            if (status == DEAD_STATUS)
+                return pos;
+            const UInt op = trans_ops[index];
+            if (op == NO_OPS)
+                continue;
+            const UInt* src = &ops[op + 1];
+            for (UInt r = 0; r != ops[op]; ++r)
+                next_regs[r] = src[r] == SET_OFFSET ? pos + 1 : regs[src[r]];
+            std::swap(regs, next_regs);
+        }
+
+        const UInt accept = accept_regs[status / class_num];
+        if (accept == NO_ACCEPT)
+            return size;
+        groups_out[0] = Match_span{ 0, size };
+        const UInt* slots = &final_regs[accept];
+        for (UInt group = 1; group <= groups; ++group) {
+            const UInt open = slots[2 * group - 2], close = slots[2 * group - 1];
+            if (open != NO_REGISTER && close != NO_REGISTER)
+                groups_out[group] = Match_span{ regs[open], regs[close] - regs[open] };
+        }
+        return size;
+    }
+
+    /**
+     * @return the bytes of memory that the DFA uses
+     */
+    size_t memory_usage() const
+    {
+        return sizeof(*this) + trans.capacity() * sizeof(Status_t) +
+               (trans_ops.capacity() + ops.capacity() + accept_regs.capacity() + final_regs.capacity()) * sizeof(UInt);
+    }
+
+    static constexpr UInt DEFAULT_STATE_LIMIT = 1 << 12;
+    static constexpr Status_t DEAD_STATUS = 0;
+
+private:
+    static constexpr UInt NO_REGISTER = UInt(-1);
+    static constexpr UInt SET_OFFSET = UInt(-2);    // the source of a register that is set to the offset after the char
+    static constexpr UInt NO_OPS = UInt(-1);
+    static constexpr UInt NO_ACCEPT = UInt(-1);
+
+    /**
+     * @brief a DFA status is kept as its threads: the NFA status, then its register for every slot of the groups
+     */
+    bool subset_construct(const Pike_vm<Char_t>& vm, UInt state_limit)
+    {
+        groups = vm.groups;
+        width = 2 * groups;
+        vm.refine_classes(byte_classes);
+        const UInt class_num = byte_classes.size();
+
+        Vector<Vector<UInt>> configs;
+        Hash_map<Vector<UInt>, Status_t, Vector_hash<UInt>> config_index;
+        Vector<UInt> reg_nums;
+        auto add_config = [&](Vector<UInt>&& config, UInt reg_num) {
+            auto iter = config_index.find(config);
+            if (iter != config_index.end())
+                return iter->second;
+            const Status_t index = configs.size();
+            config_index.insert({ config, index });
+            configs.push_back(std::move(config));
+            reg_nums.push_back(reg_num);
+            reg_total = std::max(reg_total, reg_num);
+            return index;
+        };
+        add_config(Vector<UInt>(), 0);
+
+        Vector<UInt> raw, config, sources;
+        Vector<Status_t> stamps(vm.status_num, 0);
+        Status_t stamp = 0;
+
+        // the start status: the registers of the tags on the paths from the start are set to 0
+        raw.clear();
+        ++stamp;
+        add_closure(vm, vm.start, nullptr, 0, raw, stamps, stamp);
+        canonicalize(raw, 0, config, sources);
+        start_reg_num = sources.size();
+        start = add_config(std::move(config), sources.size()) * class_num;
+
+        const UInt thread_size = width + 1;
+        for (Status_t index = 0; index != configs.size(); ++index) {
+            if (configs.size() > state_limit)
+                return false;
+            for (UInt c = 0; c != class_num; ++c) {
+                const UChar uc = UChar(byte_classes.represent(c));
+                const Vector<UInt>& from = configs[index];
+                raw.clear();
+                ++stamp;
+                for (UInt thread = 0; thread < from.size(); thread += thread_size) {
+                    const Status_t s = from[thread];
+                    for (UInt range = vm.range_offsets[s]; range != vm.range_offsets[s + 1]; ++range) {
+                        const UInt* r = &vm.ranges[2 * range];
+                        if (NFA_program<Char_t>::range_lo(r) > uc)
+                            break;
+                        if (uc <= NFA_program<Char_t>::range_hi(r))
+                            add_closure(vm, NFA_program<Char_t>::range_target(r), &from[thread + 1], reg_nums[index],
+                                        raw, stamps, stamp);
+                    }
+                }
+                const UInt reg_num = reg_nums[index];
+                canonicalize(raw, reg_num, config, sources);
+                const UInt target_reg_num = sources.size();
+                const Status_t target = add_config(std::move(config), target_reg_num);
+                trans.push_back(target * class_num);
+
+                bool identity = target_reg_num == reg_num;
+                for (UInt r = 0; identity && r != target_reg_num; ++r)
+                    identity = sources[r] == r;
+                if (identity) {
+                    trans_ops.push_back(NO_OPS);
+                } else {
+                    trans_ops.push_back(ops.size());
+                    ops.push_back(target_reg_num);
+                    ops.insert(ops.end(), sources.begin(), sources.end());
+                }
+            }
+
+            const Vector<UInt>& from = configs[index];
+            UInt accept = NO_ACCEPT;
+            for (UInt thread = 0; thread < from.size(); thread += thread_size) {
+                if (vm.accepts[from[thread]]) {
+                    accept = final_regs.size();
+                    final_regs.insert(final_regs.end(), from.begin() + thread + 1, from.begin() + thread + thread_size);
+                    break;
+                }
+            }
+            accept_regs.push_back(accept);
+        }
+        return configs.size() <= state_limit;
+    }
+
+    /**
+     * @brief append the threads of the closure of the status s that are not in raw yet, in the order of preference,
+     *        a thread has the registers from (none if from is nullptr), and the register reg_num for its tags
+     */
+    void add_closure(const Pike_vm<Char_t>& vm, Status_t s, const UInt* from, UInt reg_num, Vector<UInt>& raw,
+                     Vector<Status_t>& stamps, Status_t stamp) const
+    {
+        for (UInt i = vm.closure_offsets[s]; i != vm.closure_offsets[s + 1]; ++i) {
+            const auto& entry = vm.closures[i];
+            if (stamps[entry.status] == stamp)
+                continue;
+            stamps[entry.status] = stamp;
+            const size_t thread = raw.size();
+            raw.push_back(entry.status);
+            if (from != nullptr)
+                raw.insert(raw.end(), from, from + width);
+            else
+                raw.insert(raw.end(), width, NO_REGISTER);
+            for (UInt tag = entry.tag_beg; tag != entry.tag_end; ++tag) {
+                // the slots 0 and 1 are the span of the match, they are not tags
+                raw[thread + 1 + vm.tags[tag] - 2] = reg_num;
+            }
+        }
+    }
+
+    /**
+     * @brief renumber the registers of raw in the order they first appear,
+     *        sources[r] is the register of the source status (or SET_OFFSET for new_reg) of the register r
+     */
+    void canonicalize(const Vector<UInt>& raw, UInt new_reg, Vector<UInt>& config, Vector<UInt>& sources) const
+    {
+        Vector<UInt> renumber(new_reg + 1, NO_REGISTER);
+        config = raw;
+        sources.clear();
+        const UInt thread_size = width + 1;
+        for (UInt thread = 0; thread < config.size(); thread += thread_size) {
+            for (UInt slot = thread + 1; slot != thread + thread_size; ++slot) {
+                const UInt reg = config[slot];
+                if (reg == NO_REGISTER)
+                    continue;
+                if (renumber[reg] == NO_REGISTER) {
+                    renumber[reg] = sources.size();
+                    sources.push_back(reg == new_reg ? SET_OFFSET : reg);
+                }
+                config[slot] = renumber[reg];
+            }
+        }
+    }
+
+    /**
+     * @brief trans[status + class_of(c)] is the status (the offset of its row) that status trans to with c,
+     *        and its register operations are ops[trans_ops[...]]: the number of registers, then their sources,
+     *        NO_OPS if every register is copied to itself
+     */
+    Vector<Status_t> trans;
+    Vector<UInt> trans_ops;
+    Vector<UInt> ops;
+    Vector<UInt> accept_regs;    // the offset in final_regs of the registers of the first accepting thread
+    Vector<UInt> final_regs;
+    Byte_classes byte_classes;
+    UInt groups = 0;
+    UInt width = 0;    // the slots of a thread, 2 for each group
+    UInt reg_total = 0;
+    UInt start_reg_num = 0;
+    Status_t start = DEAD_STATUS;
+};
+}  // namespace pcc
+
+#endif  // TAGGED_DFA_H_PCC_
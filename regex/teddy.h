@@ -0,0 +1,289 @@
+#pragma once
+#ifndef TEDDY_H_PCC_
+#define TEDDY_H_PCC_
+
+#include <algorithm>
+#include <cstring>
+#include <string>
+#include <type_traits>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSSE3__)
+#include <tmmintrin.h>
+#endif
+
+#include "aho_corasick.h"
+#include "pcc_config.h"
+#include "pcc_template.h"
+
+namespace pcc
+{
+/**
+ * @brief find a few literals with the fingerprints of their first chars, many positions at a time
+ *
+ *
+ * The literals are put into 8 buckets. For each of the first FINGERPRINT chars of the literals,
+ * two tables map the low and the high 4 bits of a char to the buckets that have a literal with such a char there.
+ * A position is a candidate for the buckets in the AND of the tables of the chars from it,
+ * and only the literals of those buckets are compared with the buffer there.
+ *
+ * The tables are 16 bytes, so a pshufb looks up 16 (SSSE3) or 32 (AVX2) positions at once.
+ * Without SSSE3 the same tables are looked up one position at a time.
+ * find returns the leftmost-longest occurrence, like Aho_corasick::find.
+ *
+ * For example, the literals: foo, bar
+ *              buckets: 0 : foo, 1 : bar
+ *              low 4 bits of the first char: 6 ('f') -> 0, 2 ('b') -> 1
+ */
+class Teddy
+{
+public:
+    Teddy() = default;
+
+    Teddy(const Teddy&) = default;
+
+    Teddy(Teddy&&) = default;
+
+    Teddy& operator=(const Teddy&) = default;
+
+    Teddy& operator=(Teddy&&) = default;
+
+    ~Teddy() = default;
+
+    /**
+     * @brief build the tables of the literals, the literal i has the id i
+     *
+     * @return false if there are more than MAX_LITERALS literals or an empty one, nothing is built
+     */
+    bool build(const Vector<std::string>& new_literals)
+    {
+        clear();
+        if (new_literals.empty() || new_literals.size() > MAX_LITERALS)
+            return false;
+        for (auto& literal : new_literals) {
+            if (literal.empty())
+                return false;
+        }
+        literals = new_literals;
+        fingerprint = FINGERPRINT;
+        for (auto& literal : literals)
+            fingerprint = std::min(fingerprint, UInt(literal.size()));
+
+        // the literals sorted are put into the buckets in turn, so the literals with the same prefix share a bucket
+        Vector<UInt> order(literals.size());
+        for (UInt id = 0; id != order.size(); ++id)
+            order[id] = id;
+        std::sort(order.begin(), order.end(), [&](UInt a, UInt b) { return literals[a] < literals[b]; });
+        for (UInt i = 0; i != order.size(); ++i) {
+            UInt bucket = UInt(i * BUCKET_NUM / order.size());
+            buckets[bucket].push_back(order[i]);
+            for (UInt k = 0; k != fingerprint; ++k) {
+                UChar c = UChar(literals[order[i]][k]);
+                masks[k][0][c & 0xf] |= UChar(1 << bucket);
+                masks[k][1][c >> 4] |= UChar(1 << bucket);
+            }
+        }
+        return true;
+    }
+
+    void clear()
+    {
+        literals.clear();
+        for (auto& bucket : buckets)
+            bucket.clear();
+        memset(masks, 0, sizeof(masks));
+        fingerprint = 0;
+    }
+
+    bool empty() const { return literals.empty(); }
+
+    size_t size() const { return literals.size(); }
+
+    /**
+     * @return true if the SSSE3 or AVX2 scan is compiled in
+     */
+    static constexpr bool has_simd()
+    {
+#if defined(__AVX2__) || defined(__SSSE3__)
+        return true;
+#else
+        return false;
+#endif
+    }
+
+    /**
+     * @return the leftmost-longest occurrence in [beg + from, end), the offset is end - beg if there is none
+     */
+    template <typename Iter>
+    Literal_match find(Iter beg, Iter end, size_t from) const
+    {
+        Literal_match best{ size_t(end - beg), 0, NO_PATTERN };
+        scan(beg, end, from, [&](size_t offset, UChar hit) {
+            for_each_verified(beg, end, offset, hit, [&](UInt id) {
+                if (literals[id].size() > best.length || (literals[id].size() == best.length && id < best.id))
+                    best = { offset, literals[id].size(), id };
+            });
+            return best.id == NO_PATTERN;
+        });
+        return best;
+    }
+
+    /**
+     * @brief call callback(Literal_match) for all the occurrences in [beg, end), in the order of their begins,
+     *        the scan stops if callback returns false
+     */
+    template <typename Iter, typename Callback>
+    void for_each_occurrence(Iter beg, Iter end, Callback callback) const
+    {
+        bool go_on = true;
+        scan(beg, end, 0, [&](size_t offset, UChar hit) {
+            for_each_verified(beg, end, offset, hit, [&](UInt id) {
+                if (go_on)
+                    go_on = callback(Literal_match{ offset, literals[id].size(), id });
+            });
+            return go_on;
+        });
+    }
+
+    size_t memory_usage() const
+    {
+        size_t usage = sizeof(*this);
+        for (auto& literal : literals)
+            usage += sizeof(literal) + literal.capacity();
+        for (auto& bucket : buckets)
+            usage += bucket.capacity() * sizeof(UInt);
+        return usage;
+    }
+
+    static constexpr UInt MAX_LITERALS = 32;
+    static constexpr UInt NO_PATTERN = UInt(-1);
+
+private:
+    static constexpr UInt BUCKET_NUM = 8;
+    static constexpr UInt FINGERPRINT = 3;
+
+    /**
+     * @brief call on_candidate(offset, buckets) for the candidate positions from from in order,
+     *        the scan stops if on_candidate returns false
+     */
+    template <typename Iter, typename On_candidate>
+    void scan(Iter beg, Iter end, size_t from, On_candidate on_candidate) const
+    {
+        const size_t size = end - beg;
+        if (literals.empty() || size < fingerprint)
+            return;
+        const size_t last = size - fingerprint + 1;    // the positions that the fingerprint fits
+        size_t offset = from;
+        if constexpr (std::is_pointer_v<Iter>) {
+            const UChar* data = reinterpret_cast<const UChar*>(&*beg);
+            if (!scan_simd(data, last, offset, on_candidate))
+                return;
+        }
+        for (; offset < last; ++offset) {
+            UChar hit = 0xff;
+            for (UInt k = 0; k != fingerprint; ++k) {
+                UChar c = UChar(beg[offset + k]);
+                hit &= masks[k][0][c & 0xf] & masks[k][1][c >> 4];
+            }
+            if (hit != 0 && !on_candidate(offset, hit))
+                return;
+        }
+    }
+
+    /**
+     * @brief scan the positions [offset, last) by blocks while a whole block fits, offset is left at the tail
+     *
+     * @return false if on_candidate stopped the scan
+     */
+    template <typename On_candidate>
+    bool scan_simd(const UChar* data, size_t last, size_t& offset, On_candidate& on_candidate) const
+    {
+#if defined(__AVX2__)
+        __m256i low_masks[FINGERPRINT], high_masks[FINGERPRINT];
+        for (UInt k = 0; k != fingerprint; ++k) {
+            low_masks[k] = _mm256_broadcastsi128_si256(_mm_loadu_si128(reinterpret_cast<const __m128i*>(masks[k][0])));
+            high_masks[k] = _mm256_broadcastsi128_si256(_mm_loadu_si128(reinterpret_cast<const __m128i*>(masks[k][1])));
+        }
+        const __m256i low_bits = _mm256_set1_epi8(0xf);
+        const __m256i zero = _mm256_setzero_si256();
+        alignas(32) UChar hits[32];
+        for (; offset + 32 <= last; offset += 32) {
+            __m256i hit = _mm256_set1_epi8(char(0xff));
+            for (UInt k = 0; k != fingerprint; ++k) {
+                __m256i chars = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + offset + k));
+                __m256i low = _mm256_shuffle_epi8(low_masks[k], _mm256_and_si256(chars, low_bits));
+                __m256i high =
+                    _mm256_shuffle_epi8(high_masks[k], _mm256_and_si256(_mm256_srli_epi16(chars, 4), low_bits));
+                hit = _mm256_and_si256(hit, _mm256_and_si256(low, high));
+            }
+            UInt bits = ~UInt(_mm256_movemask_epi8(_mm256_cmpeq_epi8(hit, zero)));
+            if (bits == 0)
+                continue;
+            _mm256_store_si256(reinterpret_cast<__m256i*>(hits), hit);
+            for (; bits != 0; bits &= bits - 1) {
+                UInt i = UInt(__builtin_ctz(bits));
+                if (!on_candidate(offset + i, hits[i]))
+                    return false;
+            }
+        }
+#elif defined(__SSSE3__)
+        __m128i low_masks[FINGERPRINT], high_masks[FINGERPRINT];
+        for (UInt k = 0; k != fingerprint; ++k) {
+            low_masks[k] = _mm_loadu_si128(reinterpret_cast<const __m128i*>(masks[k][0]));
+            high_masks[k] = _mm_loadu_si128(reinterpret_cast<const __m128i*>(masks[k][1]));
+        }
+        const __m128i low_bits = _mm_set1_epi8(0xf);
+        const __m128i zero = _mm_setzero_si128();
+        alignas(16) UChar hits[16];
+        for (; offset + 16 <= last; offset += 16) {
+            __m128i hit = _mm_set1_epi8(char(0xff));
+            for (UInt k = 0; k != fingerprint; ++k) {
+                __m128i chars = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + offset + k));
+                __m128i low = _mm_shuffle_epi8(low_masks[k], _mm_and_si128(chars, low_bits));
+                __m128i high = _mm_shuffle_epi8(high_masks[k], _mm_and_si128(_mm_srli_epi16(chars, 4), low_bits));
+                hit = _mm_and_si128(hit, _mm_and_si128(low, high));
+            }
+            UInt bits = ~UInt(_mm_movemask_epi8(_mm_cmpeq_epi8(hit, zero))) & 0xffff;
+            if (bits == 0)
+                continue;
+            _mm_store_si128(reinterpret_cast<__m128i*>(hits), hit);
+            for (; bits != 0; bits &= bits - 1) {
+                UInt i = UInt(__builtin_ctz(bits));
+                if (!on_candidate(offset + i, hits[i]))
+                    return false;
+            }
+        }
+#else
+        (void)data;
+        (void)last;
+        (void)offset;
+        (void)on_candidate;
+#endif
+        return true;
+    }
+
+    /**
+     * @brief call on_verified(id) for the literals of the buckets in hit that occur at offset
+     */
+    template <typename Iter, typename On_verified>
+    void for_each_verified(Iter beg, Iter end, size_t offset, UChar hit, On_verified on_verified) const
+    {
+        const size_t size = end - beg;
+        for (; hit != 0; hit &= hit - 1) {
+            for (UInt id : buckets[__builtin_ctz(hit)]) {
+                const std::string& literal = literals[id];
+                if (literal.size() <= size - offset && std::equal(literal.begin(), literal.end(), beg + offset))
+                    on_verified(id);
+            }
+        }
+    }
+
+    Vector<std::string> literals;
+    Vector<UInt> buckets[BUCKET_NUM];
+    UChar masks[FINGERPRINT][2][16] = {};    // masks[k][0 / 1][the low / high 4 bits of the k-th char] is the buckets
+    UInt fingerprint = 0;
+};
+}  // namespace pcc
+
+#endif  // TEDDY_H_PCC_
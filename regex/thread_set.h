@@ -0,0 +1,270 @@
+#pragma once
+#ifndef THREAD_SET_H_PCC_
+#define THREAD_SET_H_PCC_
+
+#include <algorithm>
+#include <utility>
+
+#include "fa_status.h"
+#include "pcc_config.h"
+#include "pcc_template.h"
+#include "sparse_set.h"
+
+namespace pcc
+{
+using namespace fa_status;
+
+/**
+ * @brief the threads of a step of the NFA simulation, in the order that they are inserted
+ *
+ *
+ * A thread is a status with a count (see NFA_program), the status out of the counted repeats always have the count 0.
+ * The status are kept in a Sparse_set of [0, size()) with the count of their first thread,
+ * a status that is reached again with another count in the same step gets its count set:
+ * the sorted counts of the status that are alive, like the counter sets of a counting-set automaton.
+ * So the set takes O(size()) memory for the status and O(the threads alive) for the counts,
+ * it does not grow with the max of a counted repeat.
+ *
+ * The engines keep the data of a thread (the begin of its match, its slots) at the index of the thread in the set.
+ *
+ * For example, a regex: (ab){2,1000}, the status 2 -(a)-> 3 -(b)-> 4 are in X
+ *              find in "ababa", after the last a the threads are (3, 2) (3, 1) (3, 0), the count set of 3 is [0 1 2]
+ */
+class Thread_set
+{
+public:
+    struct Thread {
+        Status_t status;
+        UInt count;
+    };
+
+    Thread_set() = default;
+
+    Thread_set(const Thread_set&) = default;
+
+    Thread_set(Thread_set&&) = default;
+
+    Thread_set& operator=(const Thread_set&) = default;
+
+    Thread_set& operator=(Thread_set&&) = default;
+
+    ~Thread_set() = default;
+
+    /**
+     * @brief make the set able to hold the status in [0, status_num), only allocate when status_num grows
+     */
+    void reserve(UInt status_num)
+    {
+        statuses.reserve(status_num);
+        if (first_counts.size() < status_num) {
+            first_counts.resize(status_num);
+            threads.reserve(status_num);
+        }
+    }
+
+    /**
+     * @return true if the thread of the status s with the count was not in the set, it is added at the end
+     */
+    bool insert(Status_t s, UInt count)
+    {
+        if (statuses.insert(s)) {
+            first_counts[s] = count;
+            threads.push_back(Thread{ s, count });
+            return true;
+        }
+        if (first_counts[s] == count)
+            return false;
+        counted.reserve(first_counts.size());
+        if (!counted.contains(s)) {
+            if (count_sets.size() < first_counts.size())
+                count_sets.resize(first_counts.size());
+            counted.insert(s);
+            count_sets[s].assign(1, first_counts[s]);
+        }
+        Vector<UInt>& counts = count_sets[s];
+        auto iter = std::lower_bound(counts.begin(), counts.end(), count);
+        if (iter != counts.end() && *iter == count)
+            return false;
+        counts.insert(iter, count);
+        threads.push_back(Thread{ s, count });
+        return true;
+    }
+
+    void clear()
+    {
+        statuses.clear();
+        counted.clear();
+        threads.clear();
+    }
+
+    bool empty() const { return threads.empty(); }
+
+    UInt size() const { return threads.size(); }
+
+    const Thread& operator[](UInt index) const { return threads[index]; }
+
+    const Thread* begin() const { return threads.data(); }
+
+    const Thread* end() const { return threads.data() + threads.size(); }
+
+    void swap(Thread_set& other)
+    {
+        statuses.swap(other.statuses);
+        counted.swap(other.counted);
+        first_counts.swap(other.first_counts);
+        count_sets.swap(other.count_sets);
+        threads.swap(other.threads);
+    }
+
+    /**
+     * @return the bytes of memory that the set uses
+     */
+    size_t memory_usage() const
+    {
+        size_t usage = sizeof(*this) + (statuses.capacity() + counted.capacity()) * 2 * sizeof(UInt) +
+                       first_counts.capacity() * sizeof(UInt) + count_sets.capacity() * sizeof(Vector<UInt>) +
+                       threads.capacity() * sizeof(Thread);
+        for (const Vector<UInt>& counts : count_sets)
+            usage += counts.capacity() * sizeof(UInt);
+        return usage;
+    }
+
+private:
+    Sparse_set statuses;
+    Sparse_set counted;               // the status that have their count sets in this step
+    Vector<UInt> first_counts;        // first_counts[s] is the count of the first thread of s in this step
+    Vector<Vector<UInt>> count_sets;  // count_sets[s] is the sorted counts of s, if s is in counted
+    Vector<Thread> threads;
+};
+
+/**
+ * @brief the threads that reach no accept status after their offset in a buffer, kept between the finds of
+ *        Regex_iterator, like the failed (status, offset) pairs of the linear maximal-munch tokenizer
+ *
+ *
+ * A find that has found the match [match_beg, match_end) runs on until the threads of the match die,
+ * so a thread that it runs at an offset from match_end on can not reach an accept status after the offset,
+ * or the match would be longer. The next find begins at match_end, it does not run such a thread again,
+ * so every thread is run at an offset by a bounded number of finds.
+ *
+ * A find logs the threads it runs after its match by log(), drop_log() when the match grows,
+ * and commit_log() when it returns, then they are in the set.
+ *
+ * For example, a regex: a|a*b, find all in "aaaa"
+ *              the first find matches [0, 1) and runs a* to the end, a* fails at 1, 2, 3,
+ *              the next finds match [1, 2), [2, 3), [3, 4) without running a* again
+ */
+class Failed_threads
+{
+public:
+    Failed_threads() = default;
+
+    Failed_threads(const Failed_threads&) = default;
+
+    Failed_threads(Failed_threads&&) = default;
+
+    Failed_threads& operator=(const Failed_threads&) = default;
+
+    Failed_threads& operator=(Failed_threads&&) = default;
+
+    ~Failed_threads() = default;
+
+    void clear()
+    {
+        lists.clear();
+        log_entries.clear();
+        first = 0;
+        base = 0;
+    }
+
+    /**
+     * @brief forget the threads at the offsets before from, the finds do not go back before it
+     */
+    void advance(size_t from)
+    {
+        if (from <= base)
+            return;
+        if (first + (from - base) >= lists.size()) {
+            lists.clear();
+            first = 0;
+        } else {
+            first += from - base;
+            // the lists before first are erased when they are half of the lists, so advance takes O(1) on average
+            if (first * 2 > lists.size()) {
+                lists.erase(lists.begin(), lists.begin() + first);
+                first = 0;
+            }
+        }
+        base = from;
+    }
+
+    bool contains(size_t offset, Status_t s, UInt count) const
+    {
+        if (offset < base || first + (offset - base) >= lists.size())
+            return false;
+        const Vector<Thread_set::Thread>& list = lists[first + (offset - base)];
+        return std::binary_search(list.begin(), list.end(), Thread_set::Thread{ s, count }, less);
+    }
+
+    /**
+     * @brief log a thread that the find runs at the offset after its match, the offsets are logged in order
+     */
+    void log(size_t offset, const Thread_set::Thread& thread) { log_entries.push_back(Entry{ offset, thread }); }
+
+    void drop_log() { log_entries.clear(); }
+
+    /**
+     * @brief add the logged threads to the set
+     */
+    void commit_log()
+    {
+        for (size_t i = 0; i != log_entries.size();) {
+            const size_t offset = log_entries[i].offset;
+            if (offset < base) {
+                ++i;
+                continue;
+            }
+            const size_t index = first + (offset - base);
+            if (index >= lists.size())
+                lists.resize(index + 1);
+            Vector<Thread_set::Thread>& list = lists[index];
+            const size_t old_size = list.size();
+            for (; i != log_entries.size() && log_entries[i].offset == offset; ++i)
+                list.push_back(log_entries[i].thread);
+            std::sort(list.begin() + old_size, list.end(), less);
+            std::inplace_merge(list.begin(), list.begin() + old_size, list.end(), less);
+        }
+        log_entries.clear();
+    }
+
+    /**
+     * @return the bytes of memory that the set uses
+     */
+    size_t memory_usage() const
+    {
+        size_t usage = sizeof(*this) + lists.capacity() * sizeof(Vector<Thread_set::Thread>) +
+                       log_entries.capacity() * sizeof(Entry);
+        for (const Vector<Thread_set::Thread>& list : lists)
+            usage += list.capacity() * sizeof(Thread_set::Thread);
+        return usage;
+    }
+
+private:
+    struct Entry {
+        size_t offset;
+        Thread_set::Thread thread;
+    };
+
+    static bool less(const Thread_set::Thread& left, const Thread_set::Thread& right)
+    {
+        return left.status < right.status || (left.status == right.status && left.count < right.count);
+    }
+
+    Vector<Vector<Thread_set::Thread>> lists;    // lists[first + i] is the sorted threads that fail at base + i
+    Vector<Entry> log_entries;
+    size_t first = 0;
+    size_t base = 0;
+};
+}  // namespace pcc
+
+#endif  // THREAD_SET_H_PCC_
@@ -0,0 +1,102 @@
+#include <atomic>
+#include <cstdlib>
+#include <new>
+#include <string>
+
+#include "regex.h"
+#include "test_check.h"
+
+using namespace pcc;
+
+/**
+ * @brief every operator new of the program is counted, so a match that allocates changes the count
+ */
+static std::atomic<size_t> allocations{ 0 };
+
+void* operator new(size_t size)
+{
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    if (void* p = std::malloc(size == 0 ? 1 : size))
+        return p;
+    throw std::bad_alloc();
+}
+
+void* operator new[](size_t size) { return operator new(size); }
+
+void operator delete(void* p) noexcept { std::free(p); }
+
+void operator delete[](void* p) noexcept { std::free(p); }
+
+void operator delete(void* p, size_t) noexcept { std::free(p); }
+
+void operator delete[](void* p, size_t) noexcept { std::free(p); }
+
+/**
+ * @brief run match, search and find (and the groups versions if the regex has groups) with the scratch
+ *        on all the inputs
+ *
+ * @return a sum of the results, so that the calls are not removed
+ */
+static size_t run_all(const Regex& regex, const Vector<std::string>& inputs, Match_scratch<Char>& scratch,
+                      Vector<Match_span>& groups)
+{
+    size_t sum = 0;
+    for (const std::string& input : inputs) {
+        auto beg = input.begin(), end = input.end();
+        sum += regex_match(regex, beg, end, scratch).second;
+        sum += regex_search(regex, beg, end, scratch).second;
+        auto found = regex_find(regex, beg, end, scratch);
+        sum += found.second - found.first;
+        if (regex.group_num() != 0) {
+            sum += regex_match(regex, beg, end, groups, scratch).second;
+            sum += regex_search(regex, beg, end, groups, scratch).second;
+            found = regex_find(regex, beg, end, groups, scratch);
+            sum += found.second - found.first + groups.size();
+        }
+    }
+    return sum;
+}
+
+int main()
+{
+    // the NFA, the bit-parallel NFA, a counted repeat, the Pike VM and a regex with too many char trans
+    // for the bit-parallel NFA
+    std::string long_alternation = "(";
+    for (char c = 'a'; c <= 'z'; ++c)
+        long_alternation += std::string(12, c) + (c == 'z' ? ")+" : "|");
+    const Vector<std::string> patterns = { "[a-z]+[0-9]*",       "(ab|cd)*e+[0-9]{2,5}", "(ab|cd){2,300}x",
+                                           "([a-z]+)=([0-9]*)",  "(a|b)*c(d|e){1,3}",    long_alternation };
+    const Vector<std::string> inputs = { "",
+                                         "abc123",
+                                         "xx abcdcdeee0123 yy",
+                                         "key=12345 other=6",
+                                         "abababcd" + std::string(40, 'c') + "x",
+                                         "aabbc" + std::string(30, 'd'),
+                                         std::string(100, 'a') + std::string(48, 'q') + "zzzzzzzzzzzz",
+                                         std::string(1000, 'b') + "cde" };
+
+    size_t sum = 0;
+    for (const std::string& pattern : patterns) {
+        for (bool dfa : { false, true }) {
+            Regex regex(pattern.c_str());
+            if (dfa) {
+                regex.compile_dfa();
+                regex.compile_tagged_dfa();
+            }
+            Match_scratch<Char> scratch(regex);
+            Vector<Match_span> groups;
+            // the scratch and the groups grow to the regex and the inputs in the first run
+            sum += run_all(regex, inputs, scratch, groups);
+
+            const size_t before = allocations.load();
+            for (int round = 0; round != 3; ++round)
+                sum += run_all(regex, inputs, scratch, groups);
+            const size_t after = allocations.load();
+            if (after != before)
+                fprintf(stderr, "%s (dfa %d): %zu allocations\n", pattern.c_str(), int(dfa), after - before);
+            CHECK(after == before);
+        }
+    }
+    CHECK(sum != 0);
+    return pcc_test::test_result("alloc_test");
+}
@@ -0,0 +1,97 @@
+#include <random>
+#include <sstream>
+#include <string>
+
+#include "regex.h"
+#include "test_check.h"
+#include "thread_pool.h"
+
+using namespace pcc;
+
+/**
+ * @brief a random regex of the grammar that Regex supports
+ */
+static std::string random_pattern(std::mt19937& rng, int depth = 0)
+{
+    static const char* const atoms[] = { "a", "b", "c", "x", ".", "[a-c]", "[^ab]", "\\\\.", "[0-9]" };
+    static const char* const repeats[] = { "", "", "", "*", "+", "?", "{2,4}", "{1,}", "{,3}", "{2,12}" };
+    std::string pattern;
+    const int pieces = 1 + rng() % 4;
+    for (int i = 0; i != pieces; ++i) {
+        if (depth < 2 && rng() % 5 == 0)
+            pattern += "(" + random_pattern(rng, depth + 1) + ")";
+        else
+            pattern += atoms[rng() % (sizeof(atoms) / sizeof(atoms[0]))];
+        pattern += repeats[rng() % (sizeof(repeats) / sizeof(repeats[0]))];
+    }
+    if (rng() % 4 == 0)
+        pattern += "|" + random_pattern(rng, depth + 1);
+    return pattern;
+}
+
+/**
+ * @brief the results of match, search and find of the regex on every input, compared between the compilations
+ */
+static Vector<size_t> results_of(const Regex& regex, const Vector<std::string>& inputs)
+{
+    Vector<size_t> results;
+    for (const std::string& input : inputs) {
+        auto beg = input.begin(), end = input.end();
+        results.push_back(regex_match(regex, beg, end).second);
+        auto searched = regex_search(regex, beg, end);
+        results.push_back(searched.first - beg);
+        results.push_back(searched.second);
+        auto found = regex_find(regex, beg, end);
+        results.push_back(found.first - beg);
+        results.push_back(found.second - beg);
+    }
+    results.push_back(regex.group_num());
+    return results;
+}
+
+int main()
+{
+    static constexpr size_t PATTERN_NUM = 200;
+    static constexpr size_t COMPILATION_NUM = 2000;    // every pattern is compiled 10 times, often at the same time
+
+    std::mt19937 rng(2024);
+    Vector<std::string> patterns, inputs;
+    for (size_t i = 0; i != PATTERN_NUM; ++i)
+        patterns.push_back(random_pattern(rng));
+    for (size_t i = 0; i != 24; ++i) {
+        std::string input;
+        for (size_t length = rng() % 48; length != 0; --length)
+            input += "abcx.09y"[rng() % 8];
+        inputs.push_back(input);
+    }
+
+    Vector<Vector<size_t>> expected(PATTERN_NUM);
+    for (size_t i = 0; i != PATTERN_NUM; ++i)
+        expected[i] = results_of(Regex(patterns[i].c_str()), inputs);
+
+    Thread_pool pool(8);
+    Vector<char> same(COMPILATION_NUM, 0);
+    pool.run(COMPILATION_NUM, [&](size_t task, UInt) {
+        const std::string& pattern = patterns[task % PATTERN_NUM];
+        Regex regex;
+        // the stream compilations read the pattern through the lexer buffer of the compilation
+        bool compiled;
+        if (task % 2 == 0) {
+            std::istringstream stream(pattern);
+            compiled = regex.regenetare_regex(stream);
+        } else {
+            compiled = regex.regenetare_regex(std::string_view(pattern));
+        }
+        same[task] = compiled && results_of(regex, inputs) == expected[task % PATTERN_NUM];
+    });
+
+    size_t different = 0;
+    for (size_t task = 0; task != COMPILATION_NUM; ++task) {
+        if (!same[task]) {
+            ++different;
+            fprintf(stderr, "different compilation of %s\n", patterns[task % PATTERN_NUM].c_str());
+        }
+    }
+    CHECK(different == 0);
+    return pcc_test::test_result("compile_stress_test");
+}
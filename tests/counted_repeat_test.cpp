@@ -0,0 +1,53 @@
+#include <string>
+
+#include "match_scratch.h"
+#include "regex.h"
+#include "test_check.h"
+
+using namespace pcc;
+
+int main()
+{
+    // 40 rounds of abc|def, every max below is at least 100, so all the regex match the same
+    std::string input;
+    for (int i = 0; i != 20; ++i)
+        input += "abcdef";
+    const std::string tail = input + "x";
+
+    size_t usage = 0;
+    for (const char* pattern : { "(abc|def){1,100}", "(abc|def){1,1000}", "(abc|def){1,65535}" }) {
+        Regex regex(pattern);
+        Match_scratch<Char> scratch(regex);
+        // search starts a thread at every position, so the count sets of the repeat hold many counts at once
+        CHECK(regex_match(regex, input.begin(), input.end(), Match_engine::NFA, scratch).second);
+        CHECK(regex_search(regex, tail.begin(), tail.end(), Match_engine::NFA, scratch).second);
+        auto found = regex_find(regex, tail.begin(), tail.end(), scratch);
+        CHECK(found.first == tail.begin() && found.second == tail.end() - 1);
+        CHECK(!regex_match(regex, tail.begin(), tail.end(), Match_engine::NFA, scratch).second);
+        if (usage == 0)
+            usage = scratch.memory_usage();
+        // the scratch holds the count sets of the status, not a thread for every count
+        CHECK(scratch.memory_usage() == usage);
+
+        // the lazy DFA keeps the counts in its status, whatever the max is
+        Match_scratch<Char> dfa_scratch(regex);
+        const size_t empty_usage = dfa_scratch.memory_usage();
+        CHECK(regex_match(regex, input.begin(), input.end(), Match_engine::LAZY_DFA, dfa_scratch).second);
+        CHECK(regex_search(regex, tail.begin(), tail.end(), Match_engine::LAZY_DFA, dfa_scratch).second);
+        CHECK(!regex_match(regex, tail.begin(), tail.end(), Match_engine::LAZY_DFA, dfa_scratch).second);
+        CHECK(dfa_scratch.memory_usage() > empty_usage);
+    }
+
+    // the lazy DFA makes a status for every count that is reached, not for every count up to 65000
+    Regex big("(a|b)*c(abcdefghij|klmnopqrst){2,65000}");
+    std::string text = "abbac";
+    for (int i = 0; i != 30; ++i)
+        text += i % 3 == 0 ? "klmnopqrst" : "abcdefghij";
+    CHECK(regex_match(big, text.begin(), text.end()).second);
+    Match_scratch<Char> big_scratch(big);
+    CHECK(regex_match(big, text.begin(), text.end(), Match_engine::LAZY_DFA, big_scratch).second);
+    CHECK(!regex_match(big, text.begin(), text.end() - 1, Match_engine::LAZY_DFA, big_scratch).second);
+    CHECK(big_scratch.memory_usage() > Match_scratch<Char>(big).memory_usage());
+    CHECK(!regex_match(big, text.begin(), text.begin() + 15, Match_engine::NFA).second);
+    return pcc_test::test_result("counted_repeat_test");
+}
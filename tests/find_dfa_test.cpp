@@ -0,0 +1,135 @@
+#include <random>
+#include <string>
+
+#include "regex.h"
+#include "regex_iterator.h"
+#include "test_check.h"
+
+using namespace pcc;
+
+static std::mt19937 rng(25);
+
+static std::string random_regex(int depth);
+
+/**
+ * @brief a char, a class, any char or a group
+ */
+static std::string random_atom(int depth)
+{
+    switch (rng() % (depth < 2 ? 7 : 6)) {
+    case 0:
+        return "a";
+    case 1:
+        return "b";
+    case 2:
+        return "c";
+    case 3:
+        return ".";
+    case 4:
+        return "[ab]";
+    case 5:
+        return "[^a]";
+    default:
+        return "(" + random_regex(depth + 1) + ")";
+    }
+}
+
+static std::string random_piece(int depth)
+{
+    std::string atom = random_atom(depth);
+    const UInt min = rng() % 3, max = min + rng() % 3;
+    switch (rng() % 8) {
+    case 0:
+        return atom + "*";
+    case 1:
+        return atom + "+";
+    case 2:
+        return atom + "?";
+    case 3:
+        return atom + "{" + std::to_string(min) + "," + std::to_string(max) + "}";
+    default:
+        return atom;
+    }
+}
+
+/**
+ * @brief an alternation of 1 to 3 branches, every branch has 1 to 3 pieces
+ */
+static std::string random_regex(int depth)
+{
+    std::string regex;
+    for (UInt branch = 0, branch_num = 1 + rng() % 3; branch != branch_num; ++branch) {
+        if (branch != 0)
+            regex += "|";
+        for (UInt piece = 0, piece_num = 1 + rng() % 3; piece != piece_num; ++piece)
+            regex += random_piece(depth);
+    }
+    return regex;
+}
+
+/**
+ * @brief the offsets and lengths of all the matches, found by find_all with the Find_dfa of the regex if it has one
+ */
+static Vector<size_t> find_all_spans(const Regex& regex, const std::string& input, Match_scratch<Char>& scratch)
+{
+    Vector<size_t> spans;
+    find_all(regex, input.begin(), input.end(), scratch, [&spans](const Match_span& span) {
+        spans.push_back(span.offset);
+        spans.push_back(span.length);
+    });
+    return spans;
+}
+
+/**
+ * @brief the same as find_all_spans, but every match is found by a new regex_find from the end of the last match
+ */
+static Vector<size_t> find_loop_spans(const Regex& regex, const std::string& input, Match_scratch<Char>& scratch)
+{
+    Vector<size_t> spans;
+    for (auto from = input.begin();;) {
+        auto found = regex_find(regex, from, input.end(), scratch);
+        if (found.first == found.second)
+            return spans;
+        spans.push_back(found.first - input.begin());
+        spans.push_back(found.second - found.first);
+        from = found.second;
+    }
+}
+
+int main()
+{
+    Vector<std::string> patterns = { "a|a*b", "(a|ab)(c|bcd)", "(ab)*a", "a*", "[^a]*c|b+", "(a|b)*c(a|b){2,2}" };
+    while (patterns.size() != 400)
+        patterns.push_back(random_regex(0));
+    Vector<std::string> inputs;
+    for (size_t i = 0; i != 20; ++i) {
+        std::string input;
+        for (size_t length = rng() % 40; length != 0; --length)
+            input += "abcd"[rng() % 4];
+        inputs.push_back(input);
+    }
+
+    // the same pattern is found by the NFA in nfa and by the Find_dfa in dfa
+    size_t dfa_num = 0;
+    for (const std::string& pattern : patterns) {
+        Regex nfa(pattern.c_str()), dfa(pattern.c_str());
+        if (!dfa.compile_dfa() || !dfa.has_find_dfa())
+            continue;
+        ++dfa_num;
+        Match_scratch<Char> nfa_scratch(nfa), dfa_scratch(dfa);
+        for (const std::string& input : inputs) {
+            for (auto from = input.begin(); from != input.end(); ++from) {
+                auto expected = regex_find(nfa, from, input.end(), nfa_scratch);
+                auto found = regex_find(dfa, from, input.end(), dfa_scratch);
+                CHECK(found == expected);
+            }
+            const Vector<size_t> expected = find_loop_spans(nfa, input, nfa_scratch);
+            CHECK(find_all_spans(nfa, input, nfa_scratch) == expected);
+            CHECK(find_all_spans(dfa, input, dfa_scratch) == expected);
+            CHECK(find_loop_spans(dfa, input, dfa_scratch) == expected);
+        }
+    }
+    // almost every pattern is small enough for the DFA, so the checks above are not skipped
+    CHECK(dfa_num * 10 >= patterns.size() * 9);
+    return pcc_test::test_result("find_dfa_test");
+}
@@ -0,0 +1,107 @@
+#include <random>
+#include <string>
+
+#include "regex_cache.h"
+#include "regex_set.h"
+#include "test_check.h"
+#include "thread_pool.h"
+
+using namespace pcc;
+
+/**
+ * @brief the results of match and search of the regex on every input with the engine,
+ *        with the scratch if it is not null
+ */
+static Vector<size_t> results_of(const Regex& regex, const Vector<std::string>& inputs, UInt engine,
+                                 Match_scratch<Char>* scratch)
+{
+    Vector<size_t> results;
+    for (const std::string& input : inputs) {
+        auto beg = input.begin(), end = input.end();
+        auto matched = scratch ? regex_match(regex, beg, end, engine, *scratch) : regex_match(regex, beg, end, engine);
+        results.push_back(matched.first - beg);
+        results.push_back(matched.second);
+        auto searched =
+            scratch ? regex_search(regex, beg, end, engine, *scratch) : regex_search(regex, beg, end, engine);
+        results.push_back(searched.first - beg);
+        results.push_back(searched.second);
+    }
+    return results;
+}
+
+/**
+ * @brief the patterns that match and that find a match in every input, with the scratch if it is not null
+ */
+static Vector<bool> set_results_of(const Regex_set& set, const Vector<std::string>& inputs, UInt engine,
+                                   Match_scratch<Char>* scratch)
+{
+    Vector<bool> results, matched;
+    for (const std::string& input : inputs) {
+        auto beg = input.begin(), end = input.end();
+        scratch ? set.match(beg, end, matched, engine, *scratch) : set.match(beg, end, matched, engine);
+        results.insert(results.end(), matched.begin(), matched.end());
+        scratch ? set.find(beg, end, matched, engine, *scratch) : set.find(beg, end, matched, engine);
+        results.insert(results.end(), matched.begin(), matched.end());
+    }
+    return results;
+}
+
+int main()
+{
+    // the counted repeats make many DFA status, so the small cache of the last regex is flushed often
+    const Vector<const char*> patterns = { "[a-c]*(ab|cd)+[a-d]*", "(a|b)*c(a|b|c){3,6}", "(ab|b)*c?d+",
+                                           "((a|b)(a|b))*",        "[^d]*d[a-d]{2,9}",    "(a|bc|d)*b+(c|d)*" };
+    std::mt19937 rng(20);
+    Vector<std::string> inputs;
+    for (size_t i = 0; i != 40; ++i) {
+        std::string input;
+        for (size_t length = rng() % 200; length != 0; --length)
+            input += "abcd"[rng() % 4];
+        inputs.push_back(input);
+    }
+
+    Regex_cache cache;
+    Vector<Regex_cache::Regex_ptr> regexes;
+    for (const char* pattern : patterns)
+        regexes.push_back(cache.get(pattern));
+    Regex small_cache("(a|b)*c(a|b|c){3,6}");
+    small_cache.set_lazy_dfa_cache_limit(8);
+    Vector<const Regex*> shared;
+    for (const auto& regex : regexes)
+        shared.push_back(regex.get());
+    shared.push_back(&small_cache);
+
+    Vector<Vector<size_t>> expected;
+    for (const Regex* regex : shared)
+        expected.push_back(results_of(*regex, inputs, Match_engine::NFA, nullptr));
+    Regex_set set;
+    for (const char* pattern : patterns)
+        CHECK(set.add(pattern));
+    set.compile();
+    const Vector<bool> set_expected = set_results_of(set, inputs, Match_engine::NFA, nullptr);
+
+    // every thread matches all the regex and the set with the lazy DFA at the same time, half the tasks with their own scratch,
+    // the others with the scratch of the thread, which is built again whenever the regex changes
+    static constexpr size_t TASK_NUM = 400;
+    Thread_pool pool(8);
+    Vector<char> same(TASK_NUM, 0);
+    pool.run(TASK_NUM, [&](size_t task, UInt) {
+        Match_scratch<Char> scratch;
+        bool task_same = true;
+        for (size_t i = 0; i != shared.size(); ++i) {
+            const size_t index = (i + task) % shared.size();
+            task_same = task_same && results_of(*shared[index], inputs, Match_engine::LAZY_DFA,
+                                                task % 2 == 0 ? &scratch : nullptr) == expected[index];
+        }
+        // the set keeps its two lazy DFA in the scratch too
+        task_same = task_same && set_results_of(set, inputs, Match_engine::LAZY_DFA,
+                                                task % 2 == 0 ? &scratch : nullptr) == set_expected;
+        same[task] = task_same;
+    });
+
+    size_t different = 0;
+    for (char task_same : same)
+        different += !task_same;
+    CHECK(different == 0);
+    return pcc_test::test_result("lazy_dfa_share_test");
+}
@@ -0,0 +1,52 @@
+#include <random>
+#include <string>
+
+#include "parallel_dfa.h"
+#include "test_check.h"
+
+using namespace pcc;
+
+int main()
+{
+    // the DFA of some of them forget where they were after a few chars, the others (like (..)*) never do,
+    // the lanes of ((a|b)(a|b))*|(a|b)*cd (the even one accepts) are merged by c, then none of them accepts
+    const Vector<const char*> patterns = { "[a-c]*(ab|cd)+[a-d]*", "(ab|b)*c?",   "((a|b)(a|b))*",    "[^x]*x[a-d]*",
+                                           "(a|bc|d)*b+(c|d)*",    "[a-d]+ab",    "(abc|ab|a)*d?a*",  "a*b*c*d*",
+                                           "(a[bc]{2,5})*d*",      ".*dd.*",      "(ba|ab|cd)*x?",
+                                           "((a|b)(a|b))*|(a|b)*cd" };
+    std::mt19937 rng(17);
+    size_t compared = 0;
+    for (const char* pattern : patterns) {
+        Regex regex(pattern);
+        CHECK(regex.compile_dfa());
+        for (UInt thread_num : { 1u, 2u, 3u, 8u }) {
+            Thread_pool pool(thread_num);
+            for (size_t min_chunk_size : { size_t(1), size_t(7), size_t(64), size_t(300), size_t(5000) }) {
+                Parallel_dfa parallel_dfa(pool, min_chunk_size);
+                for (int round = 0; round != 12; ++round) {
+                    // mostly chars that keep the DFA alive, the input sometimes ends with a char that kills it
+                    std::string input;
+                    const size_t length = rng() % 3000;
+                    const char* chars = round % 3 == 0 ? "abcd" : round % 3 == 1 ? "ab" : "abcdx";
+                    const size_t char_num = round % 3 == 0 ? 4 : round % 3 == 1 ? 2 : 5;
+                    for (size_t i = 0; i != length; ++i)
+                        input += chars[rng() % char_num];
+                    if (round % 4 == 2)
+                        input += "c";
+                    if (round % 4 == 3)
+                        input += "zzz";
+                    const Char* beg = input.data();
+                    const Char* end = beg + input.size();
+
+                    auto expected_match = regex_match(regex, beg, end, Match_engine::DFA);
+                    auto expected_search = regex_search(regex, beg, end, Match_engine::DFA);
+                    CHECK(parallel_dfa.match(regex, beg, end) == expected_match);
+                    CHECK(parallel_dfa.search(regex, beg, end) == expected_search);
+                    compared += 2;
+                }
+            }
+        }
+    }
+    CHECK(compared != 0);
+    return pcc_test::test_result("parallel_dfa_test");
+}
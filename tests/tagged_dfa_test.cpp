@@ -0,0 +1,110 @@
+#include <random>
+#include <string>
+
+#include "regex.h"
+#include "test_check.h"
+
+using namespace pcc;
+
+static std::mt19937 rng(24);
+
+static std::string random_regex(int depth);
+
+/**
+ * @brief a char, a class, any char or a capture group, the groups are more often near the top
+ */
+static std::string random_atom(int depth)
+{
+    switch (rng() % (depth < 2 ? 7 : 5)) {
+    case 0:
+        return "a";
+    case 1:
+        return "b";
+    case 2:
+        return "c";
+    case 3:
+        return ".";
+    case 4:
+        return "[ab]";
+    default:
+        return "(" + random_regex(depth + 1) + ")";
+    }
+}
+
+static std::string random_piece(int depth)
+{
+    std::string atom = random_atom(depth);
+    switch (rng() % 7) {
+    case 0:
+        return atom + "*";
+    case 1:
+        return atom + "+";
+    case 2:
+        return atom + "?";
+    default:
+        return atom;
+    }
+}
+
+/**
+ * @brief an alternation of 1 or 2 branches, every branch has 1 to 3 pieces
+ */
+static std::string random_regex(int depth)
+{
+    std::string regex;
+    for (UInt branch = 0, branch_num = 1 + rng() % 2; branch != branch_num; ++branch) {
+        if (branch != 0)
+            regex += "|";
+        for (UInt piece = 0, piece_num = 1 + rng() % 3; piece != piece_num; ++piece)
+            regex += random_piece(depth);
+    }
+    return regex;
+}
+
+int main()
+{
+    // the groups of these depend on which branch or which round of a star the registers prefer
+    Vector<std::string> patterns = { "(a|ab)(c|bcd)(d*)", "(a*)(a*)",     "(a|b)*",         "((a)|b)*",
+                                     "(a*)*b",            "(a?)(ab)?(b?)", "(ab|a)(bc|c)?", "(a+|b+)*c",
+                                     "(a|ab)*(b*)",       "((a|b)(c)?)*" };
+    const size_t fixed_num = patterns.size();
+    while (patterns.size() != 200)
+        patterns.push_back("(" + random_regex(0) + ")" + random_piece(0));
+    Vector<std::string> inputs;
+    for (size_t i = 0; i != 30; ++i) {
+        std::string input;
+        for (size_t length = rng() % 16; length != 0; --length)
+            input += "abcd"[rng() % 4];
+        inputs.push_back(input);
+    }
+
+    // the groups of the same pattern are found by the Pike VM in pike and by the tagged DFA in tagged
+    size_t tagged_num = 0;
+    Vector<Match_span> expected, groups;
+    for (size_t i = 0; i != patterns.size(); ++i) {
+        Regex pike(patterns[i].c_str()), tagged(patterns[i].c_str());
+        const bool built = tagged.compile_tagged_dfa();
+        CHECK(built || i >= fixed_num);
+        if (!built)
+            continue;
+        ++tagged_num;
+        Match_scratch<Char> pike_scratch(pike), tagged_scratch(tagged);
+        for (const std::string& input : inputs) {
+            auto beg = input.begin(), end = input.end();
+            auto matched = regex_match(pike, beg, end, expected, pike_scratch);
+            CHECK(regex_match(tagged, beg, end, groups, tagged_scratch) == matched);
+            CHECK(!matched.second || groups == expected);
+
+            auto searched = regex_search(pike, beg, end, expected, pike_scratch);
+            CHECK(regex_search(tagged, beg, end, groups, tagged_scratch) == searched);
+            CHECK(searched.second == 0 || groups == expected);
+
+            auto found = regex_find(pike, beg, end, expected, pike_scratch);
+            CHECK(regex_find(tagged, beg, end, groups, tagged_scratch) == found);
+            CHECK(found.first == found.second || groups == expected);
+        }
+    }
+    // almost every pattern is small enough for the tagged DFA, so the checks above are not skipped
+    CHECK(tagged_num * 10 >= patterns.size() * 9);
+    return pcc_test::test_result("tagged_dfa_test");
+}
@@ -0,0 +1,42 @@
+#pragma once
+#ifndef TEST_CHECK_H_PCC_
+#define TEST_CHECK_H_PCC_
+
+#include <cstdio>
+
+namespace pcc_test
+{
+/**
+ * @brief the number of failed checks of the test, the test exits with 1 if it is not 0
+ */
+inline int& failures()
+{
+    static int count = 0;
+    return count;
+}
+
+inline void check(bool ok, const char* what, const char* file, int line)
+{
+    if (ok)
+        return;
+    ++failures();
+    fprintf(stderr, "%s:%d: check failed: %s\n", file, line, what);
+}
+
+inline int test_result(const char* name)
+{
+    if (failures() != 0) {
+        fprintf(stderr, "%s: %d checks failed\n", name, failures());
+        return 1;
+    }
+    printf("%s: passed\n", name);
+    return 0;
+}
+}  // namespace pcc_test
+
+/**
+ * @brief unlike assert, the check is also done with NDEBUG, and the test goes on after a failed check
+ */
+#define CHECK(EXP) pcc_test::check(static_cast<bool>(EXP), #EXP, __FILE__, __LINE__)
+
+#endif  // TEST_CHECK_H_PCC_
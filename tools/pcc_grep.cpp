@@ -0,0 +1,361 @@
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstdlib>
+#include <cstdio>
+#include <cstring>
+
+#include <algorithm>
+
+#include "regex.h"
+#include "regex_set.h"
+#include "thread_pool.h"
+
+using namespace pcc;
+
+/**
+ * @brief pcc-grep [-c | -l] [-n] [-j threads] regex file...
+ *
+ *
+ * Print the lines of the files that have a match of the regex, like grep,
+ * a regex that matches the empty string matches every line.
+ * -c : print the number of the matched lines of every file
+ * -l : print the name of the files that have a matched line
+ * -n : print the line number before every line
+ * -j : split every file into chunks of lines and grep them on the threads of a Thread_pool,
+ *      the output is the same as with one thread
+ *
+ * The files are mapped by mmap and never copied, the matched lines are written from the mapping to stdout.
+ * If the regex has a literal that every match contains,
+ * the whole mapping is searched for the literal and only the lines that have it are matched,
+ * otherwise every line is matched. A line is matched by the lazy DFA of a Regex_set of the regex.
+ *
+ * Exit with 0 if some line is matched, 1 if none, 2 on error.
+ */
+struct Grep_options {
+    enum Mode { LINES, COUNT, FILES };
+
+    Mode mode = LINES;
+    bool line_number = false;
+    bool show_file = false;
+    UInt thread_num = 1;
+};
+
+class Mapped_file
+{
+public:
+    Mapped_file() = default;
+
+    Mapped_file(const Mapped_file&) = delete;
+
+    Mapped_file& operator=(const Mapped_file&) = delete;
+
+    ~Mapped_file() { close(); }
+
+    /**
+     * @brief map the whole file read only, and hint the kernel that it is read from the begin to the end
+     */
+    bool open(const char* file_name)
+    {
+        close();
+        int fd = ::open(file_name, O_RDONLY);
+        if (fd < 0)
+            return false;
+        struct stat st;
+        if (fstat(fd, &st) != 0) {
+            ::close(fd);
+            return false;
+        }
+        size = size_t(st.st_size);
+        if (size != 0) {
+            void* addr = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (addr == MAP_FAILED) {
+                ::close(fd);
+                size = 0;
+                return false;
+            }
+            data = static_cast<const Char*>(addr);
+            madvise(addr, size, MADV_SEQUENTIAL);
+            madvise(addr, size, MADV_WILLNEED);
+#ifdef MADV_HUGEPAGE
+            madvise(addr, size, MADV_HUGEPAGE);    // only taken where the page cache supports huge pages
+#endif
+        }
+        ::close(fd);
+        return true;
+    }
+
+    void close()
+    {
+        if (data != nullptr)
+            munmap(const_cast<Char*>(data), size);
+        data = nullptr;
+        size = 0;
+    }
+
+    const Char* begin() const { return data; }
+
+    const Char* end() const { return data + size; }
+
+private:
+    const Char* data = nullptr;
+    size_t size = 0;
+};
+
+class Line_grep
+{
+public:
+    Line_grep(const Regex& regex, const Grep_options& options) : options(options)
+    {
+        set.add(regex);
+        set.compile();
+        const Literal_prefilter<Char>& prefilter = regex.get_prefilter();
+        use_prefix = prefilter.prefix().size() >= prefilter.inner().size();
+        const auto& literal = use_prefix ? prefilter.prefix() : prefilter.inner();
+        has_literal = !literal.empty() && literal.find('\n') == literal.npos;
+        this->prefilter = &prefilter;
+        // Regex_set::find only finds the not empty matches
+        const Char* empty = "";
+        matches_empty = regex_match(regex, empty, empty).second;
+    }
+
+    /**
+     * @brief call print(line_no, line, size) for the matched lines in [beg, end) in order (only in the mode LINES),
+     *        the first line of [beg, end) is the line first_line_no
+     *
+     * @return the number of the matched lines
+     */
+    template <typename Print>
+    size_t grep(const Char* beg, const Char* end, size_t first_line_no, Print print)
+    {
+        const size_t size = end - beg;
+        size_t count = 0, line_no = first_line_no, counted_to = 0;
+        size_t line_beg = 0;
+        while (line_beg < size) {
+            if (has_literal) {
+                size_t candidate = use_prefix ? prefilter->find_prefix(beg, end, line_beg)
+                                              : prefilter->find_inner(beg, end, line_beg);
+                if (candidate == size)
+                    break;
+                line_beg = line_begin(beg, line_beg, candidate);
+            }
+            const Char* line_end = static_cast<const Char*>(memchr(beg + line_beg, '\n', size - line_beg));
+            size_t next_line = line_end == nullptr ? size : line_end - beg + 1;
+            size_t line_size = (line_end == nullptr ? size : line_end - beg) - line_beg;
+
+            if (matches_empty ||
+                set.find(beg + line_beg, beg + line_beg + line_size, matched, Match_engine::LAZY_DFA) != 0) {
+                ++count;
+                if (options.mode == Grep_options::FILES)
+                    break;
+                if (options.mode == Grep_options::LINES) {
+                    if (options.line_number) {
+                        line_no += count_lines(beg + counted_to, beg + line_beg);
+                        counted_to = line_beg;
+                    }
+                    print(line_no, beg + line_beg, line_size);
+                }
+            }
+            line_beg = next_line;
+        }
+        return count;
+    }
+
+    static size_t count_lines(const Char* beg, const Char* end)
+    {
+        size_t lines = 0;
+        for (const void* found; (found = memchr(beg, '\n', end - beg)) != nullptr; ++lines)
+            beg = static_cast<const Char*>(found) + 1;
+        return lines;
+    }
+
+    /**
+     * @brief write the line to stdout (buffered by setvbuf), the line is not copied
+     */
+    void print_line(const char* file_name, size_t line_no, const Char* line, size_t size) const
+    {
+        if (options.show_file)
+            printf("%s:", file_name);
+        if (options.line_number)
+            printf("%zu:", line_no);
+        fwrite(line, 1, size, stdout);
+        putchar('\n');
+    }
+
+private:
+    /**
+     * @return the offset of the begin of the line that has the offset pos, the line begins at or after from
+     */
+    static size_t line_begin(const Char* beg, size_t from, size_t pos)
+    {
+        while (pos > from && beg[pos - 1] != '\n')
+            --pos;
+        return pos;
+    }
+
+    const Grep_options& options;
+    Regex_set set;
+    const Literal_prefilter<Char>* prefilter;
+    Vector<bool> matched;
+    bool use_prefix;
+    bool has_literal;
+    bool matches_empty;
+};
+
+/**
+ * @brief a matched line of a chunk, it is printed from the mapping after the chunks of the round are grepped
+ */
+struct Matched_line {
+    size_t line_no;
+    size_t offset;
+    size_t size;
+};
+
+/**
+ * @brief grep the file by chunks of lines on the threads of the pool, and print the lines in order
+ *
+ *
+ * The chunks are grepped in rounds of about 4 chunks for each thread, and a chunk is at most MAX_CHUNK_SIZE bytes,
+ * so only the matched lines of one round are kept (as offsets in the mapping) before they are printed.
+ *
+ * @return the number of the matched lines
+ */
+static size_t parallel_grep(Thread_pool& pool, Vector<Line_grep>& greps, const Grep_options& options,
+                            const char* file_name, const Char* beg, const Char* end)
+{
+    static constexpr size_t MAX_CHUNK_SIZE = 1 << 20;
+    const size_t size = end - beg;
+    const size_t round_chunks = size_t(pool.size()) * 4;
+    const size_t chunk_size = std::min(size / round_chunks + 1, MAX_CHUNK_SIZE);
+    const bool print = options.mode == Grep_options::LINES;
+
+    Vector<size_t> bounds, first_line_no, counts;
+    Vector<Vector<Matched_line>> lines(round_chunks);
+    size_t count = 0, line_no = 1;
+    for (size_t round_beg = 0; round_beg < size;) {
+        // the chunks end after a '\n'
+        bounds.assign(1, round_beg);
+        while (bounds.size() <= round_chunks && bounds.back() < size) {
+            const void* found = bounds.back() + chunk_size < size
+                                    ? memchr(beg + bounds.back() + chunk_size, '\n', size - bounds.back() - chunk_size)
+                                    : nullptr;
+            bounds.push_back(found == nullptr ? size : static_cast<const Char*>(found) - beg + 1);
+        }
+        const size_t chunk_num = bounds.size() - 1;
+
+        first_line_no.assign(chunk_num, line_no);
+        if (print && options.line_number) {
+            pool.run(chunk_num, [&](size_t chunk, UInt) {
+                first_line_no[chunk] = Line_grep::count_lines(beg + bounds[chunk], beg + bounds[chunk + 1]);
+            });
+            for (size_t chunk = 0; chunk != chunk_num; ++chunk) {
+                size_t chunk_lines = first_line_no[chunk];
+                first_line_no[chunk] = line_no;
+                line_no += chunk_lines;
+            }
+        }
+
+        counts.assign(chunk_num, 0);
+        pool.run(chunk_num, [&](size_t chunk, UInt thread_index) {
+            Vector<Matched_line>& chunk_lines = lines[chunk];
+            chunk_lines.clear();
+            counts[chunk] = greps[thread_index].grep(
+                beg + bounds[chunk], beg + bounds[chunk + 1], first_line_no[chunk],
+                [&](size_t no, const Char* line, size_t line_size) {
+                    chunk_lines.push_back(Matched_line{ no, size_t(line - beg), line_size });
+                });
+        });
+        for (size_t chunk = 0; chunk != chunk_num; ++chunk) {
+            count += counts[chunk];
+            for (const Matched_line& line : lines[chunk])
+                greps[0].print_line(file_name, line.line_no, beg + line.offset, line.size);
+        }
+        if (options.mode == Grep_options::FILES && count != 0)
+            break;
+        round_beg = bounds.back();
+    }
+    return count;
+}
+
+static int usage()
+{
+    fprintf(stderr, "usage: pcc-grep [-c | -l] [-n] [-j threads] regex file...\n");
+    return 2;
+}
+
+int main(int argc, char* argv[])
+{
+    Grep_options options;
+    int arg = 1;
+    for (; arg < argc && argv[arg][0] == '-' && argv[arg][1] != '\0'; ++arg) {
+        if (strcmp(argv[arg], "-j") == 0) {
+            if (arg + 1 == argc || atoi(argv[arg + 1]) <= 0)
+                return usage();
+            options.thread_num = UInt(atoi(argv[++arg]));
+            continue;
+        }
+        for (const char* flag = argv[arg] + 1; *flag != '\0'; ++flag) {
+            switch (*flag) {
+                case 'c':
+                    options.mode = Grep_options::COUNT;
+                    break;
+                case 'l':
+                    options.mode = Grep_options::FILES;
+                    break;
+                case 'n':
+                    options.line_number = true;
+                    break;
+                default:
+                    return usage();
+            }
+        }
+    }
+    if (argc - arg < 2)
+        return usage();
+
+    Regex regex;
+    if (!regex.regenetare_regex(static_cast<const Char*>(argv[arg]))) {
+        fprintf(stderr, "pcc-grep: wrong regex <%s>\n", argv[arg]);
+        return 2;
+    }
+    ++arg;
+    options.show_file = argc - arg > 1;
+
+    static char out_buff[1 << 16];
+    setvbuf(stdout, out_buff, _IOFBF, sizeof(out_buff));
+    Thread_pool pool(options.thread_num);
+    Vector<Line_grep> greps;
+    for (UInt i = 0; i != pool.size(); ++i)
+        greps.emplace_back(regex, options);
+    Mapped_file file;
+    bool any_match = false, error = false;
+    for (; arg < argc; ++arg) {
+        if (!file.open(argv[arg])) {
+            fprintf(stderr, "pcc-grep: %s: %s\n", argv[arg], strerror(errno));
+            error = true;
+            continue;
+        }
+        size_t count = 0;
+        if (pool.size() == 1) {
+            const char* file_name = argv[arg];
+            count = greps[0].grep(file.begin(), file.end(), 1, [&](size_t line_no, const Char* line, size_t size) {
+                greps[0].print_line(file_name, line_no, line, size);
+            });
+        } else {
+            count = parallel_grep(pool, greps, options, argv[arg], file.begin(), file.end());
+        }
+        any_match = any_match || count != 0;
+        if (options.mode == Grep_options::COUNT) {
+            if (options.show_file)
+                printf("%s:", argv[arg]);
+            printf("%zu\n", count);
+        } else if (options.mode == Grep_options::FILES && count != 0) {
+            printf("%s\n", argv[arg]);
+        }
+    }
+    fflush(stdout);
+    return error ? 2 : any_match ? 0 : 1;
+}